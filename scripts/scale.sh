@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Copyright (c) Prevail Verifier contributors.
+# SPDX-License-Identifier: MIT
+
+# Verify generated programs of one family for n = STEP, 2*STEP, ..., MAX,
+# in a fresh process each, to see how time and memory grow with n.
+#
+# Usage:
+#    scripts/scale.sh FAMILY MAX [STEP] > FAMILY.csv
+#    python3 scripts/makeplot.py FAMILY.csv n
+# where FAMILY is one of straight_line, nested_loops, diamonds, stack_copy
+# and packet_parse.
+if [[ $# -lt 2 ]]; then
+   echo "Usage: $0 FAMILY MAX [STEP]"
+   exit 64
+fi
+
+FAMILY=$1
+MAX=$2
+STEP=${3:-1}
+./scale @headers
+for n in $(seq $STEP $STEP $MAX)
+do
+	./scale $FAMILY $n
+done
@@ -3,11 +3,16 @@
 #include <cassert>
 
 #include <algorithm>
+#include <array>
+#include <bitset>
+#include <limits>
 #include <map>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include <boost/container/small_vector.hpp>
+
 #include "crab_utils/debug.hpp"
 #include "asm_syntax.hpp"
 #include "crab/cfg.hpp"
@@ -18,14 +23,14 @@ using std::string;
 using std::to_string;
 using std::vector;
 
-static optional<label_t> get_jump(Instruction ins) {
+static optional<label_t> get_jump(const Instruction& ins) {
     if (std::holds_alternative<Jmp>(ins)) {
         return std::get<Jmp>(ins).target;
     }
     return {};
 }
 
-static bool has_fall(Instruction ins) {
+static bool has_fall(const Instruction& ins) {
     if (std::holds_alternative<Exit>(ins))
         return false;
 
@@ -35,43 +40,6 @@ static bool has_fall(Instruction ins) {
     return true;
 }
 
-/// Convert an instruction sequence to a control-flow graph (CFG).
-static cfg_t instruction_seq_to_cfg(const InstructionSeq& insts) {
-    cfg_t cfg;
-    std::optional<label_t> falling_from = {};
-    bool first = true;
-    for (const auto& [label, inst] : insts) {
-
-        if (std::holds_alternative<Undefined>(inst))
-            continue;
-
-        auto& bb = cfg.insert(label);
-
-        if (first) {
-            first = false;
-            cfg.get_node(cfg.entry_label()) >> bb;
-        }
-
-        bb.insert(inst);
-        if (falling_from) {
-            cfg.get_node(*falling_from) >> bb;
-            falling_from = {};
-        }
-        if (has_fall(inst))
-            falling_from = label;
-        auto jump_target = get_jump(inst);
-        if (jump_target)
-            bb >> cfg.insert(*jump_target);
-
-        if (std::holds_alternative<Exit>(inst))
-            bb >> cfg.get_node(cfg.exit_label());
-    }
-    if (falling_from)
-        throw std::invalid_argument{"fallthrough in last instruction"};
-
-    return cfg;
-}
-
 /// Get the inverse of a given comparison operation.
 static Condition::Op reverse(Condition::Op op) {
     switch (op) {
@@ -100,6 +68,87 @@ static Condition::Op reverse(Condition::Op op) {
 /// Get the inverse of a given comparison condition.
 static Condition reverse(Condition cond) { return {.op = reverse(cond.op), .left = cond.left, .right = cond.right}; }
 
+// Register fields of ebpf_inst are 4 bits wide, even if only r0-r10 exist.
+using reg_set_t = std::bitset<16>;
+
+/// Get the registers that a given instruction may write.
+static reg_set_t written_registers(const Instruction& ins) {
+    reg_set_t res;
+    auto scratch_caller_saved_registers = [&res] {
+        for (uint8_t i = R0_RETURN_VALUE; i <= R5_ARG; i++) {
+            res.set(i);
+        }
+    };
+    std::visit(overloaded{
+                   [&](const Bin& bin) { res.set(bin.dst.v); },
+                   [&](const Un& un) { res.set(un.dst.v); },
+                   [&](const LoadMapFd& ins) { res.set(ins.dst.v); },
+                   [&](const Call&) { scratch_caller_saved_registers(); },
+                   [&](const Packet&) { scratch_caller_saved_registers(); },
+                   [&](const Mem& mem) {
+                       if (mem.is_load) {
+                           res.set(std::get<Reg>(mem.value).v);
+                       }
+                   },
+                   [](const auto&) {},
+               },
+               ins);
+    return res;
+}
+
+/// Get the registers that the outcome of a given assertion depends on, or
+/// nothing if it also depends on the contents of memory.
+static optional<reg_set_t> read_registers(const Assert& a) {
+    reg_set_t res;
+    bool reads_memory = false;
+    std::visit(overloaded{
+                   [&](const Comparable& s) { res.set(s.r1.v).set(s.r2.v); },
+                   [&](const Addable& s) { res.set(s.ptr.v).set(s.num.v); },
+                   [&](const ValidAccess& s) {
+                       res.set(s.reg.v);
+                       if (const Reg* width = std::get_if<Reg>(&s.width)) {
+                           res.set(width->v);
+                       }
+                   },
+                   [&](const ValidStore& s) { res.set(s.mem.v).set(s.val.v); },
+                   [&](const ValidSize& s) { res.set(s.reg.v); },
+                   [&](const ValidMapKeyValue&) { reads_memory = true; },
+                   [&](const TypeConstraint& s) { res.set(s.reg.v); },
+               },
+               a.cst);
+    if (reads_memory) {
+        return {};
+    }
+    return res;
+}
+
+// Fields of an assertion, such that identical assertions have identical keys.
+using assertion_key_t = std::array<int64_t, 5>;
+
+static assertion_key_t key_of(const Assert& a) {
+    auto index = static_cast<int64_t>(a.cst.index());
+    return std::visit(overloaded{
+                          [&](const Comparable& s) { return assertion_key_t{index, s.r1.v, s.r2.v}; },
+                          [&](const Addable& s) { return assertion_key_t{index, s.ptr.v, s.num.v}; },
+                          [&](const ValidAccess& s) {
+                              if (const Reg* width = std::get_if<Reg>(&s.width)) {
+                                  return assertion_key_t{index, s.reg.v, s.offset, s.or_null, -1 - width->v};
+                              }
+                              return assertion_key_t{index, s.reg.v, s.offset, s.or_null,
+                                                     static_cast<int64_t>(std::get<Imm>(s.width).v)};
+                          },
+                          [&](const ValidStore& s) { return assertion_key_t{index, s.mem.v, s.val.v}; },
+                          [&](const ValidSize& s) { return assertion_key_t{index, s.reg.v, s.can_be_zero}; },
+                          [&](const ValidMapKeyValue& s) {
+                              return assertion_key_t{index, s.access_reg.v, s.map_fd_reg.v, s.key};
+                          },
+                          [&](const TypeConstraint& s) {
+                              return assertion_key_t{index, s.reg.v, static_cast<int64_t>(s.types)};
+                          },
+                      },
+                      a.cst);
+}
+
 template <typename T>
 static vector<label_t> unique(const std::pair<T, T>& be) {
     vector<label_t> res;
@@ -107,59 +156,316 @@ static vector<label_t> unique(const std::pair<T, T>& be) {
     return res;
 }
 
-/// Get a non-deterministic version of a control-flow graph,
+namespace {
+
+/// Flat, index-based form of the non-deterministic control-flow graph,
 /// i.e., where instead of using if/else, both branches are taken
-/// simultaneously, and are replaced by Assume instructions
-/// immediately after the branch.
-static cfg_t to_nondet(const cfg_t& cfg) {
-    cfg_t res;
-    for (auto const& [this_label, bb] : cfg) {
-        basic_block_t& newbb = res.insert(this_label);
-
-        for (const auto& ins : bb) {
-            if (!std::holds_alternative<Jmp>(ins)) {
-                newbb.insert(ins);
+/// simultaneously, and are replaced by Assume instructions immediately
+/// after the branch. Each node holds at most one instruction, and chains
+/// of nodes are only merged into basic blocks when building the cfg_t.
+class nondet_graph_t final {
+    static constexpr size_t entry = 0;
+    static constexpr size_t exit = 1;
+    static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+    struct node_t {
+        label_t label;
+        // The instruction at label, or nullptr for entry, exit, jump nodes
+        // and jump targets that are not instructions.
+        const Instruction* ins{};
+        // The assumption of a jump node.
+        std::optional<Condition> assume{};
+        boost::container::small_vector<size_t, 2> next{};
+        size_t in_degree{};
+        // The only predecessor, if in_degree is 1.
+        size_t parent{none};
+    };
+
+    std::vector<node_t> nodes;
+    std::map<label_t, size_t> index;
+
+    size_t node_of(const label_t& label) {
+        auto [it, inserted] = index.emplace(label, nodes.size());
+        if (inserted) {
+            nodes.push_back(node_t{label});
+        }
+        return it->second;
+    }
+
+    void add_edge(size_t from, size_t to) {
+        auto& next = nodes[from].next;
+        if (std::find(next.begin(), next.end(), to) == next.end()) {
+            next.push_back(to);
+            nodes[to].in_degree++;
+            nodes[to].parent = from;
+        }
+    }
+
+    // Put the node of label make_jump(from, to), assuming cond, on the edge from -> to.
+    void insert_assume(size_t from, size_t to, const Condition& cond) {
+        size_t jump = nodes.size();
+        nodes.push_back(node_t{label_t::make_jump(nodes[from].label, nodes[to].label), nullptr, cond, {to}, 1, from});
+        nodes[to].parent = jump;
+        std::replace(nodes[from].next.begin(), nodes[from].next.end(), to, jump);
+    }
+
+    // A node that simplification merges into the block of its parent.
+    [[nodiscard]] bool is_interior(size_t n) const {
+        return nodes[n].in_degree == 1 && nodes[nodes[n].parent].next.size() == 1;
+    }
+
+    void append_instructions(std::vector<Instruction>& insts, size_t n, const std::vector<Assert>& assertions) const {
+        const node_t& node = nodes[n];
+        if (node.assume) {
+            insts.emplace_back(Assume{*node.assume});
+        } else if (node.ins) {
+            for (const Assert& a : assertions) {
+                insts.emplace_back(a);
+            }
+            if (!std::holds_alternative<Jmp>(*node.ins)) {
+                insts.push_back(*node.ins);
+            }
+        }
+    }
+
+    [[nodiscard]] std::vector<size_t> reverse_postorder() const {
+        std::vector<size_t> order;
+        std::vector<bool> visited(nodes.size());
+        // Pairs of a node and the position of its next successor to visit.
+        std::vector<std::pair<size_t, size_t>> stack{{entry, 0}};
+        visited[entry] = true;
+        while (!stack.empty()) {
+            auto& [n, i] = stack.back();
+            if (i < nodes[n].next.size()) {
+                size_t next = nodes[n].next[i++];
+                if (!visited[next]) {
+                    visited[next] = true;
+                    stack.emplace_back(next, 0);
+                }
+            } else {
+                order.push_back(n);
+                stack.pop_back();
             }
         }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
 
-        for (const label_t& prev_label : bb.prev_blocks_set()) {
-            bool is_one = cfg.get_node(prev_label).next_blocks_set().size() > 1;
-            basic_block_t& pbb = res.insert(is_one ? label_t::make_jump(prev_label, this_label) : prev_label);
-            pbb >> newbb;
+    /// Get the assertions to check before the instruction of each node.
+    /// Unless keep_redundant, leave out those that hold on entry to the
+    /// node, i.e., that were checked on every path to it with no write
+    /// to the registers they depend on since. This in particular covers
+    /// an identical assertion at a dominator of the node.
+    [[nodiscard]] std::vector<std::vector<Assert>> assertions(const program_info& info, bool keep_redundant) const {
+        std::vector<std::vector<Assert>> res(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++) {
+            if (nodes[n].ins && !nodes[n].assume) {
+                res[n] = get_assertions(*nodes[n].ins, info);
+            }
+        }
+        if (keep_redundant) {
+            return res;
         }
-        // note the special case where we jump to fallthrough
-        auto nextlist = bb.next_blocks_set();
-        if (nextlist.size() == 2) {
-            label_t mid_label = this_label;
-            Jmp jmp = std::get<Jmp>(*bb.rbegin());
-
-            nextlist.erase(jmp.target);
-            label_t fallthrough = *nextlist.begin();
-
-            vector<std::tuple<label_t, Condition>> jumps{
-                {jmp.target, *jmp.cond},
-                {fallthrough, reverse(*jmp.cond)},
-            };
-            for (auto const& [next_label, cond1] : jumps) {
-                label_t jump_label = label_t::make_jump(mid_label, next_label);
-                basic_block_t& jump_bb = res.insert(jump_label);
-                jump_bb.insert<Assume>(cond1);
-                newbb >> jump_bb;
-                jump_bb >> res.insert(next_label);
+
+        // Number the distinct assertions that may be propagated, so that a
+        // set of them is a sorted vector of ids.
+        std::map<assertion_key_t, size_t> ids;
+        std::vector<reg_set_t> reads;
+        std::vector<std::vector<size_t>> gen(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++) {
+            for (const Assert& a : res[n]) {
+                if (optional<reg_set_t> regs = read_registers(a)) {
+                    auto [it, inserted] = ids.emplace(key_of(a), reads.size());
+                    if (inserted) {
+                        reads.push_back(*regs);
+                    }
+                    gen[n].push_back(it->second);
+                }
             }
-        } else {
-            for (const auto& label : nextlist)
-                newbb >> res.insert(label);
         }
+        if (ids.empty()) {
+            return res;
+        }
+
+        std::vector<std::vector<size_t>> prev(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++) {
+            for (size_t next : nodes[n].next) {
+                prev[next].push_back(n);
+            }
+        }
+
+        // Forward must-analysis: a node that has not been reached yet does not
+        // constrain the assertions available at its successors.
+        std::vector<size_t> order = reverse_postorder();
+        std::vector<std::vector<size_t>> available_in(nodes.size());
+        std::vector<optional<std::vector<size_t>>> available_out(nodes.size());
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t n : order) {
+                optional<std::vector<size_t>> in;
+                for (size_t p : prev[n]) {
+                    if (!available_out[p]) {
+                        continue;
+                    }
+                    if (!in) {
+                        in = *available_out[p];
+                    } else {
+                        std::vector<size_t> both;
+                        std::set_intersection(in->begin(), in->end(), available_out[p]->begin(),
+                                              available_out[p]->end(), std::back_inserter(both));
+                        in->swap(both);
+                    }
+                }
+                available_in[n] = in ? std::move(*in) : std::vector<size_t>{};
+
+                std::vector<size_t> out = available_in[n];
+                for (size_t id : gen[n]) {
+                    out.insert(std::lower_bound(out.begin(), out.end(), id), id);
+                }
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+                if (nodes[n].ins) {
+                    reg_set_t written = written_registers(*nodes[n].ins);
+                    if (written.any()) {
+                        out.erase(std::remove_if(out.begin(), out.end(),
+                                                 [&](size_t id) { return (reads[id] & written).any(); }),
+                                  out.end());
+                    }
+                }
+                if (available_out[n] != out) {
+                    available_out[n] = std::move(out);
+                    changed = true;
+                }
+            }
+        }
+
+        for (size_t n = 0; n < nodes.size(); n++) {
+            std::vector<Assert> kept;
+            std::vector<size_t>& available = available_in[n];
+            size_t i = 0;
+            for (const Assert& a : res[n]) {
+                if (!read_registers(a)) {
+                    kept.push_back(a);
+                    continue;
+                }
+                size_t id = gen[n][i++];
+                auto it = std::lower_bound(available.begin(), available.end(), id);
+                if (it == available.end() || *it != id) {
+                    kept.push_back(a);
+                    // An identical assertion later on the same instruction is redundant too.
+                    available.insert(it, id);
+                }
+            }
+            res[n] = std::move(kept);
+        }
+        return res;
     }
-    return res;
-}
+
+  public:
+    explicit nondet_graph_t(const InstructionSeq& insts) {
+        nodes.push_back(node_t{label_t::entry});
+        nodes.push_back(node_t{label_t::exit});
+
+        std::optional<size_t> falling_from;
+        bool first = true;
+        for (const auto& [label, inst] : insts) {
+            if (std::holds_alternative<Undefined>(inst))
+                continue;
+
+            size_t n = node_of(label);
+            nodes[n].ins = &inst;
+
+            if (first) {
+                first = false;
+                add_edge(entry, n);
+            }
+            if (falling_from) {
+                add_edge(*falling_from, n);
+                falling_from = {};
+            }
+            if (has_fall(inst))
+                falling_from = n;
+            if (auto jump_target = get_jump(inst))
+                add_edge(n, node_of(*jump_target));
+            if (std::holds_alternative<Exit>(inst))
+                add_edge(n, exit);
+        }
+        if (falling_from)
+            throw std::invalid_argument{"fallthrough in last instruction"};
+
+        // Only conditional jumps with distinct targets have two successors.
+        for (size_t n = 0, size = nodes.size(); n < size; n++) {
+            if (nodes[n].next.size() == 2) {
+                const Jmp& jmp = std::get<Jmp>(*nodes[n].ins);
+                size_t target = index.at(jmp.target);
+                size_t fallthrough = nodes[n].next[0] == target ? nodes[n].next[1] : nodes[n].next[0];
+                insert_assume(n, target, *jmp.cond);
+                insert_assume(n, fallthrough, reverse(*jmp.cond));
+            }
+        }
+    }
+
+    /// Build the cfg_t. Unless simplify is false, combine chains of nodes
+    /// into basic blocks where possible, i.e., into a range of instructions
+    /// where there is a single entry point and a single exit point.
+    cfg_t to_cfg(const program_info& info, bool simplify) const {
+        const std::vector<std::vector<Assert>> node_assertions = assertions(info, !simplify);
+
+        // Map each node to the first node of its block, and each block to its last node.
+        std::vector<size_t> head(nodes.size(), none);
+        std::vector<size_t> tail(nodes.size(), none);
+        std::vector<std::vector<Instruction>> blocks(nodes.size());
+        for (size_t h = 0; h < nodes.size(); h++) {
+            if (simplify && is_interior(h)) {
+                continue;
+            }
+            head[h] = h;
+            size_t n = h;
+            append_instructions(blocks[h], n, node_assertions[n]);
+            while (simplify && nodes[n].next.size() == 1) {
+                size_t next = nodes[n].next[0];
+                if (next == h || nodes[next].in_degree != 1 || next == exit) {
+                    break;
+                }
+                head[next] = h;
+                n = next;
+                append_instructions(blocks[h], n, node_assertions[n]);
+            }
+            tail[h] = n;
+        }
+        // Interior nodes on a cycle with no way in keep their own block.
+        for (size_t n = 0; n < nodes.size(); n++) {
+            if (head[n] == none) {
+                head[n] = tail[n] = n;
+                append_instructions(blocks[n], n, node_assertions[n]);
+            }
+        }
+
+        cfg_t cfg;
+        for (size_t h = 0; h < nodes.size(); h++) {
+            if (head[h] == h) {
+                cfg.insert(nodes[h].label).swap_instructions(blocks[h]);
+            }
+        }
+        for (size_t h = 0; h < nodes.size(); h++) {
+            if (head[h] == h) {
+                basic_block_t& bb = cfg.get_node(nodes[h].label);
+                for (size_t next : nodes[tail[h]].next) {
+                    assert(head[next] == next);
+                    bb >> cfg.get_node(nodes[next].label);
+                }
+            }
+        }
+        return cfg;
+    }
+};
+
+} // namespace
 
 /// Get the type of a given instruction.
 /// Most of these type names are also statistics header labels.
-static std::string instype(Instruction ins) {
+static std::string instype(const Instruction& ins) {
     if (std::holds_alternative<Call>(ins)) {
-        auto call = std::get<Call>(ins);
+        const auto& call = std::get<Call>(ins);
         if (call.returns_map) {
             return "call_1";
         }
@@ -213,19 +519,19 @@ std::map<std::string, int> collect_stats(const cfg_t& cfg) {
         // and so casting from size_t to int is safe, as is the addition.
         res["instructions"] += static_cast<int>(bb.size());
 
-        for (Instruction ins : bb) {
+        for (const Instruction& ins : bb) {
             if (std::holds_alternative<LoadMapFd>(ins)) {
                 if (std::get<LoadMapFd>(ins).mapfd == -1) {
                     res["map_in_map"] = 1;
                 }
             }
             if (std::holds_alternative<Call>(ins)) {
-                auto call = std::get<Call>(ins);
+                const auto& call = std::get<Call>(ins);
                 if (call.func == 43 || call.func == 44)
                     res["adjust_head"] = 1;
             }
             if (std::holds_alternative<Bin>(ins)) {
-                auto bin = std::get<Bin>(ins);
+                const auto& bin = std::get<Bin>(ins);
                 res[bin.is64 ? "arith64" : "arith32"]++;
             }
             res[instype(ins)]++;
@@ -239,24 +545,12 @@ std::map<std::string, int> collect_stats(const cfg_t& cfg) {
 }
 
 cfg_t prepare_cfg(const InstructionSeq& prog, const program_info& info, bool simplify) {
-    // Convert the instruction sequence to a deterministic control-flow graph.
-    cfg_t det_cfg = instruction_seq_to_cfg(prog);
-
-    // Annotate the CFG by adding in assertions before every memory instruction.
-    explicate_assertions(det_cfg, info);
-
-    // Translate conditional jumps to non-determinstic jumps.
-    cfg_t cfg = to_nondet(det_cfg);
-
-    // Except when debugging, combine chains of instructions into
-    // basic blocks where possible, i.e., into a range of instructions
-    // where there is a single entry point and a single exit point.
-    // An abstract interpreter will keep values at every basic block,
+    // Translate the instruction sequence, with conditional jumps made
+    // non-deterministic and assertions before every instruction, in one
+    // pass. Except when debugging, merge chains of instructions into basic
+    // blocks. An abstract interpreter will keep values at every basic block,
     // so the fewer basic blocks we have, the less information it has to
-    // keep track of.
-    if (simplify) {
-        cfg.simplify();
-    }
-
-    return cfg;
+    // keep track of. For the same reason, also drop assertions that are
+    // implied by identical ones checked earlier.
+    return nondet_graph_t(prog).to_cfg(info, simplify);
 }
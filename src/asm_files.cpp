@@ -122,3 +122,33 @@ vector<raw_program> read_elf(const std::string& path, const std::string& desired
     }
     return res;
 }
+
+void write_elf(const std::string& path, const raw_program& raw_prog) {
+    ELFIO::elfio reader;
+    if (!reader.load(raw_prog.filename)) {
+        throw std::runtime_error(string("Can't process ELF file ") + raw_prog.filename);
+    }
+    ELFIO::section* section = reader.sections[raw_prog.section];
+    if (!section) {
+        throw std::runtime_error(string("Can't find section ") + raw_prog.section + " in file " + raw_prog.filename);
+    }
+    vector<ebpf_inst> prog = vector_of<ebpf_inst>(section);
+    if (prog.size() != raw_prog.prog.size()) {
+        throw std::runtime_error(string("Size mismatch in section ") + raw_prog.section + " of file " + raw_prog.filename);
+    }
+    for (size_t pc = 0; pc < prog.size(); pc++) {
+        if (prog[pc].opcode == INST_OP_LDDW_IMM) {
+            // Resolved by read_elf() from the relocations, which stay as they are.
+            if (raw_prog.prog[pc].opcode != INST_OP_LDDW_IMM) {
+                throw std::runtime_error("Map load replaced at " + std::to_string(pc));
+            }
+            pc++;
+            continue;
+        }
+        prog[pc] = raw_prog.prog[pc];
+    }
+    section->set_data((const char*)prog.data(), prog.size() * sizeof(ebpf_inst));
+    if (!reader.save(path)) {
+        throw std::runtime_error(string("Can't write ELF file ") + path);
+    }
+}
@@ -12,6 +12,13 @@
 std::vector<raw_program> read_raw(std::string path, program_info info);
 std::vector<raw_program> read_elf(const std::string& path, const std::string& section, const ebpf_verifier_options_t* options, const ebpf_platform_t* platform);
 
+/** Write a copy of the ELF file raw_prog.filename to path, in which the
+ *  section raw_prog.section holds the instructions of raw_prog instead.
+ *  Map loads keep their relocations, so raw_prog must have the same size and
+ *  the same map loads as the section it replaces.
+ */
+void write_elf(const std::string& path, const raw_program& raw_prog);
+
 void write_binary_file(std::string path, const char* data, size_t size);
 
 std::ifstream open_asm_file(std::string path);
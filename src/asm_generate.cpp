@@ -0,0 +1,183 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <stdexcept>
+#include <vector>
+
+#include "asm_generate.hpp"
+#include "platform.hpp"
+
+using std::string;
+using std::vector;
+
+const std::map<string, program_family_t>& program_families() {
+    static const std::map<string, program_family_t> families{
+        {"straight_line", program_family_t::straight_line}, {"nested_loops", program_family_t::nested_loops},
+        {"diamonds", program_family_t::diamonds},           {"stack_copy", program_family_t::stack_copy},
+        {"packet_parse", program_family_t::packet_parse},
+    };
+    return families;
+}
+
+program_info generated_program_info() {
+    return program_info{
+        .platform = &g_ebpf_platform_linux,
+        .type = g_ebpf_platform_linux.get_program_type("xdp", ""),
+    };
+}
+
+namespace {
+
+// Appends instructions labeled by their index. Forward jumps are emitted
+// with an unknown target, then patched once the target is emitted.
+class program_builder_t final {
+    InstructionSeq prog;
+
+  public:
+    [[nodiscard]] int pc() const { return static_cast<int>(prog.size()); }
+
+    void emit(const Instruction& ins) { prog.emplace_back(label_t(pc()), ins); }
+
+    void bin(Bin::Op op, uint8_t dst, Value v) { emit(Bin{.op = op, .dst = Reg{dst}, .v = v, .is64 = true}); }
+
+    void load(uint8_t dst, uint8_t base, int offset, int width) {
+        emit(Mem{.access = Deref{.width = width, .basereg = Reg{base}, .offset = offset}, .value = Reg{dst}, .is_load = true});
+    }
+
+    void store(uint8_t base, int offset, int width, Value v) {
+        emit(Mem{.access = Deref{.width = width, .basereg = Reg{base}, .offset = offset}, .value = v, .is_load = false});
+    }
+
+    void jump(std::optional<Condition> cond, int target) { emit(Jmp{.cond = cond, .target = label_t(target)}); }
+
+    // Return the pc of the jump, to be passed to patch().
+    int forward_jump(std::optional<Condition> cond) {
+        jump(cond, -1);
+        return pc() - 1;
+    }
+
+    void patch(int jump_pc, int target) { std::get<Jmp>(std::get<Instruction>(prog.at(jump_pc))).target = label_t(target); }
+
+    void exit(uint64_t r0) {
+        bin(Bin::Op::MOV, R0_RETURN_VALUE, Imm{r0});
+        emit(Exit{});
+    }
+
+    InstructionSeq done() { return std::move(prog); }
+};
+
+// r2 to r5 go through a cycle of operations, each reading another of them.
+InstructionSeq straight_line(int n) {
+    program_builder_t b;
+    for (uint8_t r = R2_ARG; r <= R5_ARG; r++) {
+        b.bin(Bin::Op::MOV, r, Imm{r});
+    }
+    for (int i = 0; i < n; i++) {
+        uint8_t dst = R2_ARG + i % 4;
+        uint8_t src = R2_ARG + (i + 1) % 4;
+        switch (i % 6) {
+        case 0: b.bin(Bin::Op::ADD, dst, Imm{(uint64_t)i}); break;
+        case 1: b.bin(Bin::Op::XOR, dst, Reg{src}); break;
+        case 2: b.bin(Bin::Op::MUL, dst, Imm{3}); break;
+        case 3: b.bin(Bin::Op::SUB, dst, Reg{src}); break;
+        case 4: b.bin(Bin::Op::AND, dst, Imm{0xffff}); break;
+        case 5: b.bin(Bin::Op::MOV, dst, Reg{src}); break;
+        }
+    }
+    b.exit(0);
+    return b.done();
+}
+
+// for (r1 = 0; r1 < 4; r1++) for (r2 = 0; r2 < 4; r2++) ... r0++;
+InstructionSeq nested_loops(int n) {
+    if (n < 1 || n > 9) {
+        throw std::invalid_argument("nested_loops needs 1 to 9 loops");
+    }
+    program_builder_t b;
+    b.bin(Bin::Op::MOV, R0_RETURN_VALUE, Imm{0});
+    vector<int> heads;
+    for (int d = 0; d < n; d++) {
+        b.bin(Bin::Op::MOV, R1_ARG + d, Imm{0});
+        heads.push_back(b.pc());
+    }
+    b.bin(Bin::Op::ADD, R0_RETURN_VALUE, Imm{1});
+    for (int d = n - 1; d >= 0; d--) {
+        uint8_t counter = R1_ARG + d;
+        b.bin(Bin::Op::ADD, counter, Imm{1});
+        b.jump(Condition{.op = Condition::Op::LT, .left = Reg{counter}, .right = Imm{4}}, heads[d]);
+    }
+    b.emit(Exit{});
+    return b.done();
+}
+
+// r8 += r7 > i ? -i : i, for each i, where r7 is an unknown context field.
+InstructionSeq diamonds(int n) {
+    program_builder_t b;
+    b.load(R7, R1_ARG, 12, 4);
+    b.bin(Bin::Op::MOV, R8, Imm{0});
+    for (int i = 0; i < n; i++) {
+        int to_else = b.forward_jump(Condition{.op = Condition::Op::SGT, .left = Reg{R7}, .right = Imm{(uint64_t)i}});
+        b.bin(Bin::Op::ADD, R8, Imm{(uint64_t)i});
+        int to_join = b.forward_jump({});
+        b.patch(to_else, b.pc());
+        b.bin(Bin::Op::SUB, R8, Imm{(uint64_t)i});
+        b.patch(to_join, b.pc());
+    }
+    b.exit(0);
+    return b.done();
+}
+
+// Fill a 256-byte stack buffer and copy n bytes of it, one at a time and
+// wrapping around, to the buffer right above it.
+InstructionSeq stack_copy(int n) {
+    constexpr int size = EBPF_STACK_SIZE / 2;
+    program_builder_t b;
+    for (int offset = 0; offset < size && offset < n; offset += 8) {
+        b.store(R10_STACK_POINTER, -EBPF_STACK_SIZE + offset, 8, Imm{(uint64_t)offset});
+    }
+    for (int i = 0; i < n; i++) {
+        int offset = i % size;
+        b.load(R1_ARG, R10_STACK_POINTER, -EBPF_STACK_SIZE + offset, 1);
+        b.store(R10_STACK_POINTER, -size + offset, 1, Reg{R1_ARG});
+    }
+    b.exit(0);
+    return b.done();
+}
+
+// Read the first byte of each of n consecutive 8-byte headers, dropping the
+// packet if it is too short or the byte is zero.
+InstructionSeq packet_parse(int n) {
+    constexpr int header_size = 8;
+    program_builder_t b;
+    b.load(R2_ARG, R1_ARG, 0, 4); // data
+    b.load(R3_ARG, R1_ARG, 4, 4); // data_end
+    vector<int> drops;
+    for (int i = 0; i < n; i++) {
+        b.bin(Bin::Op::MOV, R4_ARG, Reg{R2_ARG});
+        b.bin(Bin::Op::ADD, R4_ARG, Imm{(uint64_t)(header_size * (i + 1))});
+        drops.push_back(b.forward_jump(Condition{.op = Condition::Op::GT, .left = Reg{R4_ARG}, .right = Reg{R3_ARG}}));
+        b.load(R5_ARG, R2_ARG, header_size * i, 1);
+        drops.push_back(b.forward_jump(Condition{.op = Condition::Op::EQ, .left = Reg{R5_ARG}, .right = Imm{0}}));
+    }
+    b.exit(2); // XDP_PASS
+    for (int drop : drops) {
+        b.patch(drop, b.pc());
+    }
+    b.exit(1); // XDP_DROP
+    return b.done();
+}
+
+} // namespace
+
+InstructionSeq generate_program(program_family_t family, int n) {
+    if (n < 0) {
+        throw std::invalid_argument("program size must not be negative");
+    }
+    switch (family) {
+    case program_family_t::straight_line: return straight_line(n);
+    case program_family_t::nested_loops: return nested_loops(n);
+    case program_family_t::diamonds: return diamonds(n);
+    case program_family_t::stack_copy: return stack_copy(n);
+    case program_family_t::packet_parse: return packet_parse(n);
+    }
+    throw std::invalid_argument("unknown program family");
+}
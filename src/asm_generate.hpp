@@ -0,0 +1,32 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "asm_syntax.hpp"
+#include "spec_type_descriptors.hpp"
+
+/// Families of synthetic programs whose size grows with a parameter n, for
+/// measuring how the verifier scales without a compiler or a kernel.
+enum class program_family_t {
+    straight_line, ///< n ALU instructions.
+    nested_loops,  ///< n nested counted loops, for n in [1, 9]; cost grows exponentially in n.
+    diamonds,      ///< n if-then-else diamonds in sequence.
+    stack_copy,    ///< A byte by byte copy of n bytes between two stack buffers.
+    packet_parse,  ///< n bounds-checked reads of consecutive packet headers.
+};
+
+/// The families by name.
+const std::map<std::string, program_family_t>& program_families();
+
+/** Generate the program of the given family and size. Every generated
+ *  program is an XDP program, described by generated_program_info(),
+ *  that the verifier accepts.
+ *
+ *  \throws std::invalid_argument if n is out of range for the family.
+ */
+InstructionSeq generate_program(program_family_t family, int n);
+
+program_info generated_program_info();
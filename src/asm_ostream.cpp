@@ -317,7 +317,7 @@ auto get_labels(const InstructionSeq& insts) {
     return pc_of_label;
 }
 
-static bool is_satisfied(Instruction ins) {
+static bool is_satisfied(const Instruction& ins) {
     return std::holds_alternative<Assert>(ins) && std::get<Assert>(ins).satisfied;
 }
 
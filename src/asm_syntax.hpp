@@ -2,9 +2,14 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
@@ -141,7 +146,7 @@ struct Jmp {
 
 struct ArgSingle {
     // see comments in spec_prototypes.hpp
-    enum class Kind {
+    enum class Kind : uint8_t {
         MAP_FD,
         PTR_TO_MAP_KEY,
         PTR_TO_MAP_VALUE,
@@ -153,7 +158,7 @@ struct ArgSingle {
 
 /// Pair of arguments to a function for pointer and size.
 struct ArgPair {
-    enum class Kind {
+    enum class Kind : uint8_t {
         PTR_TO_MEM,
         PTR_TO_MEM_OR_NULL,
         PTR_TO_UNINIT_MEM,
@@ -163,12 +168,33 @@ struct ArgPair {
     bool can_be_zero{};
 };
 
+/// Arguments of a call, stored inline since a helper takes at most 5.
+template <typename T, size_t N>
+class ArgList {
+    std::array<T, N> args{};
+    uint8_t count{};
+
+  public:
+    void push_back(const T& arg) {
+        if (count == N)
+            throw std::length_error("too many call arguments");
+        args[count++] = arg;
+    }
+
+    [[nodiscard]] const T* begin() const { return args.data(); }
+    [[nodiscard]] const T* end() const { return args.data() + count; }
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] static constexpr size_t capacity() { return N; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+};
+
 struct Call {
     int32_t func{};
-    std::string name;
+    /// Name from the platform's helper prototype table, which outlives the program.
+    std::string_view name;
     bool returns_map{};
-    std::vector<ArgSingle> singles;
-    std::vector<ArgPair> pairs;
+    ArgList<ArgSingle, 5> singles;
+    ArgList<ArgPair, 2> pairs;
 };
 
 struct Exit {};
@@ -298,6 +324,9 @@ struct Assert {
 
 using Instruction = std::variant<Undefined, Bin, Un, LoadMapFd, Call, Exit, Jmp, Mem, Packet, LockAdd, Assume, Assert>;
 
+// Blocks are plain arrays of instructions, copied without any allocation.
+static_assert(std::is_trivially_copyable_v<Instruction>);
+
 using LabeledInstruction = std::tuple<label_t, Instruction>;
 using InstructionSeq = std::vector<LabeledInstruction>;
 
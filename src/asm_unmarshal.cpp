@@ -1,5 +1,6 @@
 // Copyright (c) Prevail Verifier contributors.
 // SPDX-License-Identifier: MIT
+#include <array>
 #include <cassert>
 #include <cstring> // memcmp
 #include <iostream>
@@ -41,14 +42,77 @@ void compare(const string& field, T actual, T expected) {
         std::cerr << field << ": (actual) " << std::hex << (int)actual << " != " << (int)expected << " (expected)\n";
 }
 
-struct InvalidInstruction : std::invalid_argument {
-    size_t pc;
-    explicit InvalidInstruction(size_t pc, const char* what) : std::invalid_argument{what}, pc{pc} {}
+/// The fields of an opcode byte that the decoder dispatches on.
+struct opcode_info_t {
+    uint8_t cls{};
+    // High nibble for ALU and JMP instructions, addressing mode for memory instructions.
+    uint8_t op{};
+    // Access width in bytes for memory instructions, 0 otherwise.
+    uint8_t width{};
+    // Why the opcode is rejected regardless of its operands, or nullptr if it is valid.
+    const char* invalid{};
 };
 
-struct UnsupportedMemoryMode : std::invalid_argument {
-    explicit UnsupportedMemoryMode(const char* what) : std::invalid_argument{what} {}
-};
+static constexpr opcode_info_t decode_opcode(uint8_t opcode) {
+    opcode_info_t info{.cls = static_cast<uint8_t>(opcode & INST_CLS_MASK)};
+    switch (info.cls) {
+    case INST_CLS_LD:
+    case INST_CLS_LDX:
+    case INST_CLS_ST:
+    case INST_CLS_STX: {
+        bool isLD = info.cls == INST_CLS_LD;
+        info.op = (opcode & INST_MODE_MASK) >> 5;
+        switch (opcode & INST_SIZE_MASK) {
+        case INST_SIZE_B: info.width = 1; break;
+        case INST_SIZE_H: info.width = 2; break;
+        case INST_SIZE_W: info.width = 4; break;
+        case INST_SIZE_DW: info.width = 8; break;
+        }
+        switch (info.op) {
+        case INST_ABS:
+            if (!isLD)
+                info.invalid = "ABS but not LD";
+            break;
+        case INST_IND:
+            if (!isLD)
+                info.invalid = "IND but not LD";
+            break;
+        case INST_MEM:
+            if (isLD)
+                info.invalid = "plain LD";
+            break;
+        case INST_LEN: info.invalid = "LEN"; break;
+        case INST_MSH: info.invalid = "MSH"; break;
+        case INST_MEM_UNUSED: info.invalid = "Memory mode 7"; break;
+        }
+        break;
+    }
+    case INST_CLS_ALU:
+    case INST_CLS_ALU64:
+        info.op = opcode >> 4;
+        if (info.op == 0xe)
+            info.invalid = "invalid ALU op 0xe";
+        if (info.op == 0xf)
+            info.invalid = "invalid ALU op 0xf";
+        break;
+    case INST_CLS_JMP:
+        info.op = opcode >> 4;
+        if (info.op == 0xe)
+            info.invalid = "invalid JMP op 0xe";
+        break;
+    case INST_CLS_UNUSED: info.invalid = "invalid class 0x6"; break;
+    }
+    return info;
+}
+
+static constexpr std::array<opcode_info_t, 256> opcode_table = [] {
+    std::array<opcode_info_t, 256> table{};
+    for (size_t opcode = 0; opcode < table.size(); opcode++) {
+        table[opcode] = decode_opcode(static_cast<uint8_t>(opcode));
+    }
+    return table;
+}();
+static_assert(opcode_table[INST_OP_LDDW_IMM].width == 8 && !opcode_table[INST_OP_LDDW_IMM].invalid);
 
 static auto getMemIsLoad(uint8_t opcode) -> bool {
     switch (opcode & INST_CLS_MASK) {
@@ -60,16 +124,6 @@ static auto getMemIsLoad(uint8_t opcode) -> bool {
     return {};
 }
 
-static auto getMemWidth(uint8_t opcode) -> int {
-    switch (opcode & INST_SIZE_MASK) {
-    case INST_SIZE_B: return 1;
-    case INST_SIZE_H: return 2;
-    case INST_SIZE_W: return 4;
-    case INST_SIZE_DW: return 8;
-    }
-    return {};
-}
-
 // static auto getMemX(uint8_t opcode) -> bool {
 //     switch (opcode & INST_CLS_MASK) {
 //         case INST_CLS_LD : return false;
@@ -83,12 +137,19 @@ static auto getMemWidth(uint8_t opcode) -> int {
 struct Unmarshaller {
     const ebpf_platform_t* platform;
     vector<vector<string>>& notes;
-    void note(const string& what) { notes.back().emplace_back(what); }
-    void note_next_pc() { notes.emplace_back(); }
-    explicit Unmarshaller(vector<vector<string>>& notes, const ebpf_platform_t* platform) : notes{notes}, platform{platform} { note_next_pc(); }
+    size_t current_pc{};
+    // Set instead of throwing when the current instruction cannot be decoded.
+    const char* error{};
+
+    void note(const string& what) {
+        if (notes.size() <= current_pc)
+            notes.resize(current_pc + 1);
+        notes[current_pc].emplace_back(what);
+    }
+    explicit Unmarshaller(vector<vector<string>>& notes, const ebpf_platform_t* platform) : platform{platform}, notes{notes} {}
 
-    auto getAluOp(size_t pc, ebpf_inst inst) -> std::variant<Bin::Op, Un::Op> {
-        switch ((inst.opcode >> 4) & 0xF) {
+    auto getAluOp(ebpf_inst inst, const opcode_info_t& info) -> std::variant<Bin::Op, Un::Op> {
+        switch (info.op) {
         case 0x0: return Bin::Op::ADD;
         case 0x1: return Bin::Op::SUB;
         case 0x2: return Bin::Op::MUL;
@@ -102,24 +163,22 @@ struct Unmarshaller {
         case 0xa: return Bin::Op::XOR;
         case 0xb: return Bin::Op::MOV;
         case 0xc:
-            if ((inst.opcode & INST_CLS_MASK) == INST_CLS_ALU)
+            if (info.cls == INST_CLS_ALU)
                 note("arsh32 is not allowed");
             return Bin::Op::ARSH;
         case 0xd:
             switch (inst.imm) {
             case 16: return Un::Op::LE16;
             case 32:
-                if ((inst.opcode & INST_CLS_MASK) == INST_CLS_ALU64)
-                    throw InvalidInstruction(pc, "invalid endian immediate 32 for 64 bit instruction");
+                if (info.cls == INST_CLS_ALU64)
+                    error = "invalid endian immediate 32 for 64 bit instruction";
                 return Un::Op::LE32;
             case 64:
-                if ((inst.opcode & INST_CLS_MASK) == INST_CLS_ALU)
-                    throw InvalidInstruction(pc, "invalid endian immediate 64 for 32 bit instruction");
+                if (info.cls == INST_CLS_ALU)
+                    error = "invalid endian immediate 64 for 32 bit instruction";
                 return Un::Op::LE64;
             default: note("invalid endian immediate; falling back to 64"); return Un::Op::LE64;
             }
-        case 0xe: throw InvalidInstruction{pc, "invalid ALU op 0xe"};
-        case 0xf: throw InvalidInstruction{pc, "invalid ALU op 0xf"};
         }
         return {};
     }
@@ -138,9 +197,9 @@ struct Unmarshaller {
         }
     }
 
-    static auto getJmpOp(size_t pc, uint8_t opcode) -> Condition::Op {
+    static auto getJmpOp(const opcode_info_t& info) -> Condition::Op {
         using Op = Condition::Op;
-        switch ((opcode >> 4) & 0xF) {
+        switch (info.op) {
         case 0x0: return {}; // goto
         case 0x1: return Op::EQ;
         case 0x2: return Op::GT;
@@ -155,36 +214,29 @@ struct Unmarshaller {
         case 0xb: return Op::LE;
         case 0xc: return Op::SLT;
         case 0xd: return Op::SLE;
-        case 0xe: throw InvalidInstruction(pc, "invalid JMP op 0xe");
         }
         return {};
     }
 
-    auto makeMemOp(ebpf_inst inst) -> Instruction {
+    // The opcode table has already rejected the unsupported modes.
+    auto makeMemOp(ebpf_inst inst, const opcode_info_t& info) -> Instruction {
         if (inst.dst > R10_STACK_POINTER || inst.src > R10_STACK_POINTER)
             note("Bad register");
 
-        int width = getMemWidth(inst.opcode);
-        bool isLD = (inst.opcode & INST_CLS_MASK) == INST_CLS_LD;
-        switch ((inst.opcode & INST_MODE_MASK) >> 5) {
+        int width = info.width;
+        switch (info.op) {
         case 0: note("Bad instruction"); return Undefined{(int)inst.opcode};
         case INST_ABS:
-            if (!isLD)
-                throw UnsupportedMemoryMode{"ABS but not LD"};
             if (width == 8)
                 note("invalid opcode LDABSDW");
             return Packet{.width = width, .offset = inst.imm, .regoffset = {}};
 
         case INST_IND:
-            if (!isLD)
-                throw UnsupportedMemoryMode{"IND but not LD"};
             if (width == 8)
                 note("invalid opcode LDINDDW");
             return Packet{.width = width, .offset = inst.imm, .regoffset = Reg{inst.src}};
 
         case INST_MEM: {
-            if (isLD)
-                throw UnsupportedMemoryMode{"plain LD"};
             bool isLoad = getMemIsLoad(inst.opcode);
             if (isLoad && inst.dst == R10_STACK_POINTER)
                 note("Cannot modify r10");
@@ -193,27 +245,20 @@ struct Unmarshaller {
             assert(!(isLoad && isImm));
             uint8_t basereg = isLoad ? inst.src : inst.dst;
 
-            if (basereg == R10_STACK_POINTER && (inst.offset + opcode_to_width(inst.opcode) > 0 || inst.offset < -EBPF_STACK_SIZE)) {
+            if (basereg == R10_STACK_POINTER && (inst.offset + width > 0 || inst.offset < -EBPF_STACK_SIZE)) {
                 note("Stack access out of bounds");
             }
-            auto res = Mem{
-                .access =
-                    Deref{
-                        .width = width,
-                        .basereg = Reg{basereg},
-                        .offset = inst.offset,
-                    },
-                .value =
-                    isLoad ? (Value)Reg{inst.dst} : (isImm ? (Value)Imm{(uint32_t)inst.imm} : (Value)Reg{inst.src}),
-                .is_load = isLoad,
+            Mem res{};
+            res.access = Deref{
+                .width = width,
+                .basereg = Reg{basereg},
+                .offset = inst.offset,
             };
+            res.value = isLoad ? (Value)Reg{inst.dst} : (isImm ? (Value)Imm{(uint32_t)inst.imm} : (Value)Reg{inst.src});
+            res.is_load = isLoad;
             return res;
         }
 
-        case INST_LEN: throw UnsupportedMemoryMode{"LEN"};
-
-        case INST_MSH: throw UnsupportedMemoryMode{"MSH"};
-
         case INST_XADD:
             return LockAdd{
                 .access =
@@ -224,12 +269,11 @@ struct Unmarshaller {
                     },
                 .valreg = Reg{inst.src},
             };
-        case INST_MEM_UNUSED: throw UnsupportedMemoryMode{"Memory mode 7"};
         }
         return {};
     }
 
-    auto makeAluOp(size_t pc, ebpf_inst inst) -> Instruction {
+    auto makeAluOp(ebpf_inst inst, const opcode_info_t& info) -> Instruction {
         if (inst.dst == R10_STACK_POINTER)
             note("Invalid target r10");
         return std::visit(overloaded{[&](Un::Op op) -> Instruction { return Un{.op = op, .dst = Reg{inst.dst}}; },
@@ -238,14 +282,14 @@ struct Unmarshaller {
                                              .op = op,
                                              .dst = Reg{inst.dst},
                                              .v = getBinValue(inst),
-                                             .is64 = (inst.opcode & INST_CLS_MASK) == INST_CLS_ALU64,
+                                             .is64 = info.cls == INST_CLS_ALU64,
                                          };
                                          if (op == Bin::Op::DIV || op == Bin::Op::MOD)
                                              if (std::holds_alternative<Imm>(res.v) && std::get<Imm>(res.v).v == 0)
                                                  note("division by zero");
                                          return res;
                                      }},
-                          getAluOp(pc, inst));
+                          getAluOp(inst, info));
     }
 
     auto makeLddw(ebpf_inst inst, int32_t next_imm, const vector<ebpf_inst>& insts, pc_t pc) -> Instruction {
@@ -293,7 +337,7 @@ struct Unmarshaller {
         return {};
     }
 
-    static auto makeCall(const ebpf_platform_t* platform, int32_t imm) {
+    auto makeCall(int32_t imm) -> Call {
         EbpfHelperPrototype proto = platform->get_helper_prototype(imm);
         Call res;
         res.func = imm;
@@ -320,6 +364,10 @@ struct Unmarshaller {
             case EbpfHelperArgumentType::PTR_TO_MEM_OR_NULL:
             case EbpfHelperArgumentType::PTR_TO_MEM:
             case EbpfHelperArgumentType::PTR_TO_UNINIT_MEM:
+                if (res.pairs.size() == res.pairs.capacity()) {
+                    error = "too many helper memory arguments";
+                    return res;
+                }
                 bool can_be_zero = (args[i + 1] == EbpfHelperArgumentType::CONST_SIZE_OR_ZERO);
                 res.pairs.push_back({toArgPairKind(args[i]), Reg{(uint8_t)i}, Reg{(uint8_t)(i + 1)}, can_be_zero});
                 i++;
@@ -328,12 +376,14 @@ struct Unmarshaller {
         }
         return res;
     }
-    auto makeJmp(ebpf_inst inst, const vector<ebpf_inst>& insts, pc_t pc) -> Instruction {
-        switch ((inst.opcode >> 4) & 0xF) {
+    auto makeJmp(ebpf_inst inst, const opcode_info_t& info, const vector<ebpf_inst>& insts, pc_t pc) -> Instruction {
+        switch (info.op) {
         case 0x8:
-            if (!platform->is_helper_usable(inst.imm))
-                throw InvalidInstruction(pc, "invalid helper function id");
-            return makeCall(platform, inst.imm);
+            if (!platform->is_helper_usable(inst.imm)) {
+                error = "invalid helper function id";
+                return Undefined{(int)inst.opcode};
+            }
+            return makeCall(inst.imm);
         case 0x9: return Exit{};
         default: {
             pc_t new_pc = pc + 1 + inst.offset;
@@ -344,7 +394,7 @@ struct Unmarshaller {
 
             auto cond = inst.opcode == INST_OP_JA ? std::optional<Condition>{}
                                                   : Condition{
-                                                        .op = getJmpOp(pc, inst.opcode),
+                                                        .op = getJmpOp(info),
                                                         .left = Reg{inst.dst},
                                                         .right = (inst.opcode & INST_SRC_REG) ? (Value)Reg{inst.src}
                                                                                               : Imm{(uint32_t)inst.imm},
@@ -357,18 +407,24 @@ struct Unmarshaller {
         }
     }
 
-    vector<LabeledInstruction> unmarshal(vector<ebpf_inst> const& insts) {
+    std::variant<InstructionSeq, std::string> unmarshal(vector<ebpf_inst> const& insts) {
         vector<LabeledInstruction> prog;
         int exit_count = 0;
         if (insts.empty()) {
             throw std::invalid_argument("Zero length programs are not allowed");
         }
-        for (size_t pc = 0; pc < insts.size();) {
+        prog.reserve(insts.size());
+        size_t pc = 0;
+        while (pc < insts.size()) {
+            current_pc = pc;
             ebpf_inst inst = insts[pc];
+            const opcode_info_t& info = opcode_table[inst.opcode];
+            if (info.invalid)
+                return invalid(pc, info.invalid);
             Instruction new_ins;
             bool lddw = false;
             bool fallthrough = true;
-            switch (inst.opcode & INST_CLS_MASK) {
+            switch (info.cls) {
             case INST_CLS_LD:
                 if (inst.opcode == INST_OP_LDDW_IMM) {
                     uint32_t next_imm = pc < insts.size() - 1 ? insts[pc + 1].imm : 0;
@@ -379,13 +435,13 @@ struct Unmarshaller {
                 // fallthrough
             case INST_CLS_LDX:
             case INST_CLS_ST:
-            case INST_CLS_STX: new_ins = makeMemOp(inst); break;
+            case INST_CLS_STX: new_ins = makeMemOp(inst, info); break;
 
             case INST_CLS_ALU:
-            case INST_CLS_ALU64: new_ins = makeAluOp(pc, inst); break;
+            case INST_CLS_ALU64: new_ins = makeAluOp(inst, info); break;
 
             case INST_CLS_JMP: {
-                new_ins = makeJmp(inst, insts, static_cast<pc_t>(pc));
+                new_ins = makeJmp(inst, info, insts, static_cast<pc_t>(pc));
                 if (std::holds_alternative<Exit>(new_ins)) {
                     fallthrough = false;
                     exit_count++;
@@ -396,9 +452,9 @@ struct Unmarshaller {
                 }
                 break;
             }
-
-            case INST_CLS_UNUSED: throw InvalidInstruction(pc, "invalid class 0x6");
             }
+            if (error)
+                return invalid(pc, error);
             /*
             vector<ebpf_inst> marshalled = marshal(new_ins[0], pc);
             ebpf_inst actual = marshalled[0];
@@ -415,27 +471,19 @@ struct Unmarshaller {
             if (pc == insts.size() - 1 && fallthrough)
                 note("fallthrough in last instruction");
             prog.emplace_back(label_t(static_cast<int>(pc)), new_ins);
-            pc++;
-            note_next_pc();
-            if (lddw) {
-                pc++;
-                note_next_pc();
-            }
+            pc += lddw ? 2 : 1;
         }
+        current_pc = pc;
         if (exit_count == 0)
             note("no exit instruction");
         return prog;
     }
+
+    static std::string invalid(size_t pc, const char* what) { return std::to_string(pc) + ": " + what + "\n"; }
 };
 
 std::variant<InstructionSeq, std::string> unmarshal(const raw_program& raw_prog, const ebpf_platform_t* platform, vector<vector<string>>& notes) {
-    try {
-        return Unmarshaller{notes,platform}.unmarshal(raw_prog.prog);
-    } catch (InvalidInstruction& arg) {
-        std::ostringstream ss;
-        ss << arg.pc << ": " << arg.what() << "\n";
-        return ss.str();
-    }
+    return Unmarshaller{notes, platform}.unmarshal(raw_prog.prog);
 }
 
 std::variant<InstructionSeq, std::string> unmarshal(const raw_program& raw_prog, const ebpf_platform_t* platform) {
@@ -17,7 +17,9 @@
  *
  *  \param raw_prog is the input program to parse.
  *  \param platform is the platform on which the instructions are intended to run.
- *  \param notes is where errors and warnings are written to.
+ *  \param notes is where errors and warnings are written to. notes[pc] holds
+ *               those of the instruction at pc; the vector is only grown as far
+ *               as the last pc that has any.
  *  \return a sequence of instruction if successful, an error string otherwise.
  */
 std::variant<InstructionSeq, std::string> unmarshal(const raw_program& raw_prog, const ebpf_platform_t* platform, std::vector<std::vector<std::string>>& notes);
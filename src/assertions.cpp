@@ -15,7 +15,7 @@ using std::to_string;
 using std::vector;
 
 class AssertExtractor {
-    program_info info;
+    const program_info& info;
 
     static Reg reg(Value v) {
         return std::get<Reg>(v);
@@ -26,7 +26,7 @@ class AssertExtractor {
     }
 
   public:
-    explicit AssertExtractor(program_info info) : info{std::move(info)} {}
+    explicit AssertExtractor(const program_info& info) : info{info} {}
 
     template <typename T>
     vector<Assert> operator()(T) const {
@@ -178,19 +178,11 @@ class AssertExtractor {
     }
 };
 
-/// Annotate the CFG by adding explicit assertions for all the preconditions
-/// of any instruction. For example, jump instructions are asserted not to
-/// compare numbers and pointers, or pointers to potentially distinct memory
-/// regions. The verifier will use these assertions to treat the program as
-/// unsafe unless it can prove that the assertions can never fail.
-void explicate_assertions(cfg_t& cfg, const program_info& info) {
-    for (auto& [label, bb] : cfg) {
-        vector<Instruction> insts;
-        for (const auto& ins : vector<Instruction>(bb.begin(), bb.end())) {
-            for (auto a : std::visit(AssertExtractor{info}, ins))
-                insts.emplace_back(a);
-            insts.push_back(ins);
-        }
-        bb.swap_instructions(insts);
-    }
+/// Return the explicit assertions for all the preconditions of an instruction.
+/// For example, jump instructions are asserted not to compare numbers and
+/// pointers, or pointers to potentially distinct memory regions. The verifier
+/// will use these assertions to treat the program as unsafe unless it can
+/// prove that the assertions can never fail.
+vector<Assert> get_assertions(const Instruction& ins, const program_info& info) {
+    return std::visit(AssertExtractor{info}, ins);
 }
@@ -2,6 +2,30 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <vector>
+
+/// How the fixpoint iterator extrapolates and refines loop invariants.
+struct fixpoint_strategy_t {
+    // Plain joins at a loop head before widening starts, by loop nesting
+    // depth (outermost loop first). Deeper loops use the last entry.
+    std::vector<unsigned int> widening_delay{1};
+
+    // Whether to refine each stabilized loop by narrowing, and for at most
+    // how many iterations. Widening with thresholds already lands on most
+    // loop bounds, so a few iterations are enough to tighten the rest.
+    bool narrowing{true};
+    unsigned int narrowing_iterations{10};
+
+    // Loops of at most small_loop_size basic blocks get small_loop_unrolling
+    // extra joins before widening, as long as the loop has been iterated
+    // fewer than max_unrolled_visits times overall. Nested loops are
+    // iterated again for every iteration of the outer loop, so this stops
+    // unrolling them once they get expensive. 0 disables unrolling.
+    unsigned int small_loop_size{};
+    unsigned int small_loop_unrolling{};
+    unsigned int max_unrolled_visits{100};
+};
+
 struct ebpf_verifier_options_t {
     bool check_termination;
     bool print_invariants;
@@ -10,6 +34,8 @@ struct ebpf_verifier_options_t {
 
     // False to use actual map fd's, true to use mock fd's.
     bool mock_map_fds;
+
+    fixpoint_strategy_t fixpoint{};
 };
 
 extern const ebpf_verifier_options_t ebpf_verifier_default_options;
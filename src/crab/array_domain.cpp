@@ -5,263 +5,117 @@
 
 namespace crab::domains {
 
-// We use a global array map
-array_map_t global_array_map;
-
-// Return true if [symb_lb, symb_ub] may overlap with the cell,
-// where symb_lb and symb_ub are not constant expressions.
-bool cell_t::symbolic_overlap(const linear_expression_t& symb_lb, const linear_expression_t& symb_ub,
-                              const NumAbsDomain& dom) const {
-
+// Return true if [symb_lb, symb_ub] may overlap with the cell, where
+// [lb_range, ub_range] over-approximates the values of symb_lb and
+// symb_ub, and the range is known to be non-empty in some state.
+bool cell_t::symbolic_overlap(const interval_t& lb_range, const interval_t& ub_range) const {
     interval_t x = to_interval();
     assert(x.lb().is_finite());
     assert(x.ub().is_finite());
-    linear_expression_t lb(*(x.lb().number()));
-    linear_expression_t ub(*(x.ub().number()));
-
-    NumAbsDomain tmp1(dom);
-    using namespace dsl_syntax;
-    tmp1 += lb >= symb_lb; //(lb >= symb_lb);
-    tmp1 += lb <= symb_ub; //(lb <= symb_ub);
-    if (!tmp1.is_bottom()) {
-        CRAB_LOG("array-expansion-overlap", std::cout << "\tyes.\n";);
-        return true;
-    }
-
-    NumAbsDomain tmp2(dom);
-    tmp2 += ub >= symb_lb; // (ub >= symb_lb);
-    tmp2 += ub <= symb_ub; // (ub <= symb_ub);
-    if (!tmp2.is_bottom()) {
-        CRAB_LOG("array-expansion-overlap", std::cout << "\tyes.\n";);
-        return true;
-    }
-
-    CRAB_LOG("array-expansion-overlap", std::cout << "\tno.\n";);
-    return false;
+    // symb_lb <= k <= symb_ub is satisfiable for one end k of the cell.
+    auto may_contain = [&](const bound_t& k) { return lb_range.lb() <= k && k <= ub_range.ub(); };
+    bool res = may_contain(x.lb()) || may_contain(x.ub());
+    CRAB_LOG("array-expansion-overlap", std::cout << "\t" << (res ? "yes" : "no") << ".\n";);
+    return res;
 }
 
-/**
-    Ugly this needs to be fixed: needed if multiple analyses are
-    run so we can clear the array map from one run to another.
-**/
-void clear_global_state() {
-    if (!global_array_map.empty()) {
-        if constexpr (crab::CrabSanityCheckFlag) {
-            CRAB_WARN("array_expansion static variable map is being cleared");
-        }
-        global_array_map.clear();
-    }
+// Call f with the offset and size of every cell of kind in inv that
+// starts at an offset in [lb, ub] and has a size of 1, 2, 4 or 8, and of
+// every interned cell. Interned cells can have any size, so they are not
+// filtered by their offset.
+template <typename F>
+static void for_each_tracked_cell(const NumAbsDomain& inv, data_kind_t kind, offset_t lb, offset_t ub, F f) {
+    auto visit = [&](variable_t v) {
+        if (auto c = v.cell_of(kind)) {
+            f(c->first, c->second);
+        }
+    };
+    if (auto range = variable_t::cell_vars(kind, lb, ub)) {
+        inv.for_each_variable(range->first, range->second, visit);
+    }
+    auto [first_interned, last_interned] = variable_t::interned_cell_vars();
+    inv.for_each_variable(first_interned, last_interned, visit);
 }
 
-void offset_map_t::remove_cell(const cell_t& c) {
-    if (std::optional<cell_set_t> cells = _map.lookup(c.get_offset())) {
-        if ((*cells).erase(c) > 0) {
-            _map.remove(c.get_offset());
-            if (!(*cells).empty()) {
-                // a bit of a waste ...
-                _map.insert(c.get_offset(), *cells);
-            }
+std::vector<cell_t> array_domain_t::get_tracked_cells(const NumAbsDomain& inv, data_kind_t kind, offset_t lb,
+                                                      offset_t ub) {
+    std::vector<cell_t> out;
+    for_each_tracked_cell(inv, kind, lb, ub, [&](offset_t offset, unsigned size) {
+        if (offset >= lb && offset <= ub) {
+            out.push_back(cell_t(offset, size));
         }
-    }
+    });
+    return out;
 }
 
-[[nodiscard]]
-std::vector<cell_t> offset_map_t::get_overlap_cells_symbolic_offset(const NumAbsDomain& dom,
-                                                                    const linear_expression_t& symb_lb,
-                                                                    const linear_expression_t& symb_ub) const {
+std::vector<cell_t> array_domain_t::get_overlap_cells_symbolic_offset(const NumAbsDomain& inv, data_kind_t kind,
+                                                                      const linear_expression_t& symb_lb,
+                                                                      const linear_expression_t& symb_ub) {
     std::vector<cell_t> out;
-    for (auto it = _map.begin(), et = _map.end(); it != et; ++it) {
-        const cell_set_t& o_cells = it->second;
-        // All cells in o_cells have the same offset. They only differ
+    interval_t lb_range = inv.eval_interval(symb_lb);
+    interval_t ub_range = inv.eval_interval(symb_ub);
+    if (lb_range.is_bottom() || ub_range.is_bottom()) {
+        return out;
+    }
+    // symb_lb <= symb_ub must hold in some state for anything to overlap.
+    // For a single end k of a cell, symb_lb <= k <= symb_ub is then
+    // satisfiable in the DBM iff k lies within [lb_range.lb(), ub_range.ub()].
+    if (inv.eval_relational_interval(symb_ub - symb_lb).ub() < 0) {
+        return out;
+    }
+    // A cell of up to 8 bytes has an end in that range only if it starts
+    // in [lb_range.lb() - 7, ub_range.ub()].
+    offset_t first = 0;
+    if (std::optional<number_t> n = lb_range.lb().number(); n && *n > 7) {
+        first = n->fits_slong() ? (offset_t)((long)*n - 7) : std::numeric_limits<offset_t>::max();
+    }
+    offset_t last = std::numeric_limits<offset_t>::max();
+    if (std::optional<number_t> n = ub_range.ub().number(); n && n->fits_slong()) {
+        last = *n < 0 ? 0 : (offset_t)(long)*n;
+    }
+    std::vector<cell_t> cells;
+    for_each_tracked_cell(inv, kind, first, last,
+                          [&](offset_t offset, unsigned size) { cells.push_back(cell_t(offset, size)); });
+    std::sort(cells.begin(), cells.end());
+    for (auto it = cells.begin(); it != cells.end();) {
+        // All cells in [it, next) have the same offset. They only differ
         // in the size. If the largest cell overlaps with [offset,
         // offset + size) then the rest of cells are considered to
         // overlap. This is an over-approximation because [offset,
         // offset+size) can overlap with the largest cell but it
         // doesn't necessarily overlap with smaller cells. For
         // efficiency, we assume it overlaps with all.
-        cell_t largest_cell;
-        for (auto& c : o_cells) {
-            if (largest_cell.is_null()) {
-                largest_cell = c;
-            } else {
-                assert(c.get_offset() == largest_cell.get_offset());
-                if (largest_cell < c) {
-                    largest_cell = c;
-                }
-            }
-        }
-        if (!largest_cell.is_null()) {
-            if (largest_cell.symbolic_overlap(symb_lb, symb_ub, dom)) {
-                for (auto& c : o_cells) {
-                    out.push_back(c);
-                }
-            }
+        auto next = std::find_if(it, cells.end(), [&](const cell_t& c) { return c.get_offset() != it->get_offset(); });
+        const cell_t& largest_cell = *std::prev(next);
+        if (largest_cell.symbolic_overlap(lb_range, ub_range)) {
+            out.insert(out.end(), it, next);
         }
+        it = next;
     }
     return out;
 }
 
-void offset_map_t::insert_cell(const cell_t& c) {
-    if (std::optional<cell_set_t> cells = _map.lookup(c.get_offset())) {
-        if ((*cells).insert(c).second) {
-            // a bit of a waste ...
-            _map.remove(c.get_offset());
-            _map.insert(c.get_offset(), *cells);
-        }
-    } else {
-        cell_set_t new_cells;
-        new_cells.insert(c);
-        _map.insert(c.get_offset(), new_cells);
-    }
-}
-
-std::optional<cell_t> offset_map_t::get_cell(offset_t o, unsigned size) const {
-    if (std::optional<cell_set_t> cells = _map.lookup(o)) {
-        cell_t tmp(o, size);
-        auto it = (*cells).find(tmp);
-        if (it != (*cells).end()) {
-            return *it;
-        }
-    }
-    // not found
-    return {};
-}
-
-cell_t offset_map_t::mk_cell(offset_t o, unsigned size) {
-    // TODO: check array is the array associated to this offset map
-
-    auto maybe_c = get_cell(o, size);
-    if (maybe_c)
-        return *maybe_c;
-    // create a new scalar variable for representing the contents
-    // of bytes array[o,o+1,..., o+size-1]
-    cell_t c(o, size);
-    insert_cell(c);
-    return c;
-}
-
-// Return all cells that might overlap with (o, size).
-std::vector<cell_t> offset_map_t::get_overlap_cells(offset_t o, unsigned size) {
+// Return all cells that might overlap with (o, size), except the cell (o, size) itself.
+std::vector<cell_t> array_domain_t::get_overlap_cells(const NumAbsDomain& inv, data_kind_t kind, offset_t o,
+                                                      unsigned size) {
     std::vector<cell_t> out;
-    compare_binding_t comp;
-
-    bool added = false;
-    auto maybe_c = get_cell(o, size);
-    if (!maybe_c) {
-        maybe_c = cell_t(o, size);
-        insert_cell(*maybe_c);
-        added = true;
-    }
-
-    auto lb_it = std::lower_bound(_map.begin(), _map.end(), o, comp);
-    if (lb_it != _map.end()) {
-        // Store _map[begin,...,lb_it] into a vector so that we can
-        // go backwards from lb_it.
-        //
-        // TODO: give support for reverse iterator in patricia_tree.
-        std::vector<cell_set_t> upto_lb;
-        upto_lb.reserve(std::distance(_map.begin(), lb_it));
-        for (auto it = _map.begin(), et = lb_it; it != et; ++it) {
-            upto_lb.push_back(it->second);
-        }
-        upto_lb.push_back(lb_it->second);
-
-        for (int i = static_cast<int>(upto_lb.size() - 1); i >= 0; --i) {
-            ///////
-            // All the cells in upto_lb[i] have the same offset. They
-            // just differ in the size.
-            //
-            // If none of the cells in upto_lb[i] overlap with (o, size)
-            // we can stop.
-            ////////
-            bool continue_outer_loop = false;
-            for (const cell_t& x : upto_lb[i]) {
-                if (x.overlap(o, size)) {
-                    if (!(x == *maybe_c)) {
-                        // FIXME: we might have some duplicates. this is a very drastic solution.
-                        if (std::find(out.begin(), out.end(), x) == out.end()) {
-                            out.push_back(x);
-                        }
-                    }
-                    continue_outer_loop = true;
-                }
-            }
-            if (!continue_outer_loop) {
-                break;
-            }
-        }
-    }
-
-    // search for overlapping cells > o
-    auto ub_it = std::upper_bound(_map.begin(), _map.end(), o, comp);
-    for (; ub_it != _map.end(); ++ub_it) {
-        bool continue_outer_loop = false;
-        for (const cell_t& x : ub_it->second) {
-            if (x.overlap(o, size)) {
-                // FIXME: we might have some duplicates. this is a very drastic solution.
-                if (std::find(out.begin(), out.end(), x) == out.end()) {
-                    out.push_back(x);
-                }
-                continue_outer_loop = true;
-            }
-        }
-        if (!continue_outer_loop) {
-            break;
-        }
-    }
-
-    // do not forget the rest of overlapping cells == o
-    for (auto it = ++lb_it, et = ub_it; it != et; ++it) {
-        bool continue_outer_loop = false;
-        for (const cell_t& x : it->second) {
-            if (x == *maybe_c) { // we dont put it in out
-                continue;
-            }
-            if (x.overlap(o, size)) {
-                if (!(x == *maybe_c)) {
-                    if (std::find(out.begin(), out.end(), x) == out.end()) {
-                        out.push_back(x);
-                    }
-                }
-                continue_outer_loop = true;
-            }
-        }
-        if (!continue_outer_loop) {
-            break;
-        }
-    }
-
-    if (added) {
-        remove_cell(*maybe_c);
-    }
+    const cell_t query(o, size);
+    // Cells of up to 8 bytes that start before o - 7 end before o.
+    const offset_t first = o >= 7 ? o - 7 : 0;
+    const offset_t last = o + std::max(size, 1u) - 1;
+    for_each_tracked_cell(inv, kind, first, last, [&](offset_t offset, unsigned x_size) {
+        const cell_t x(offset, x_size);
+        if (!(x == query) && x.overlap(o, size)) {
+            out.push_back(x);
+        }
+    });
     return out;
 }
 
-std::ostream& operator<<(std::ostream& o, const offset_map_t& m) {
-    if (m._map.empty()) {
-        o << "empty";
-    } else {
-        for (auto it = m._map.begin(), et = m._map.end(); it != et; ++it) {
-            const offset_map_t::cell_set_t& cells = it->second;
-            o << "{";
-            for (auto cit = cells.begin(), cet = cells.end(); cit != cet;) {
-                o << *cit;
-                ++cit;
-                if (cit != cet) {
-                    o << ",";
-                }
-            }
-            o << "}\n";
-        }
-    }
-    return o;
-}
-
 std::optional<std::pair<offset_t, unsigned>>
 array_domain_t::kill_and_find_var(NumAbsDomain& inv, data_kind_t kind, const linear_expression_t& i, const linear_expression_t& elem_size) {
     std::optional<std::pair<offset_t, unsigned>> res;
 
-    offset_map_t& offset_map = lookup_array_map(kind);
     interval_t ii = inv.eval_interval(i);
     std::vector<cell_t> cells;
     if (std::optional<number_t> n = ii.singleton()) {
@@ -271,22 +125,19 @@ array_domain_t::kill_and_find_var(NumAbsDomain& inv, data_kind_t kind, const lin
             unsigned size = (long)(*n_bytes);
             // -- Constant index: kill overlapping cells
             offset_t o((long)*n);
-            cells = offset_map.get_overlap_cells(o, size);
+            cells = get_overlap_cells(inv, kind, o, size);
             res = std::make_pair(o, size);
         }
     }
     if (!res) {
         // -- Non-constant index: kill overlapping cells
-        cells = offset_map.get_overlap_cells_symbolic_offset(inv, linear_expression_t(i),
-                                                             linear_expression_t(i + elem_size));
+        cells = get_overlap_cells_symbolic_offset(inv, kind, linear_expression_t(i),
+                                                  linear_expression_t(i + elem_size));
     }
-    if (!cells.empty()) {
-        // Forget the scalars from the numerical domain
-        for (auto c : cells) {
-            inv -= c.get_scalar(kind);
-        }
-        // Remove the cells. If needed again they they will be re-created.
-        offset_map -= cells;
+    // Forget the scalars from the numerical domain. This also removes the
+    // cells; if needed again they will be re-created.
+    for (auto c : cells) {
+        inv -= c.get_scalar(kind);
     }
     return res;
 }
@@ -302,7 +153,6 @@ bool array_domain_t::all_num(NumAbsDomain& inv, const linear_expression_t& lb, c
 std::optional<linear_expression_t> array_domain_t::load(NumAbsDomain& inv, data_kind_t kind, const linear_expression_t& i, int width) {
     interval_t ii = inv.eval_interval(i);
     if (std::optional<number_t> n = ii.singleton()) {
-        offset_map_t& offset_map = lookup_array_map(kind);
         long k = (long)*n;
         if (kind == data_kind_t::types) {
             auto [only_num, only_non_num] = num_bytes.uniformity(k, width);
@@ -315,9 +165,9 @@ std::optional<linear_expression_t> array_domain_t::load(NumAbsDomain& inv, data_
         }
         offset_t o(k);
         unsigned size = (long)width;
-        std::vector<cell_t> cells = offset_map.get_overlap_cells(o, size);
+        std::vector<cell_t> cells = get_overlap_cells(inv, kind, o, size);
         if (cells.empty()) {
-            cell_t c = offset_map.mk_cell(o, size);
+            cell_t c(o, size);
             // Here it's ok to do assignment (instead of expand)
             // because c is not a summarized variable. Otherwise, it
             // would be unsound.
@@ -339,6 +189,34 @@ std::optional<linear_expression_t> array_domain_t::load(NumAbsDomain& inv, data_
     return {};
 }
 
+void array_domain_t::forget_dead(const NumAbsDomain& inv, const std::bitset<EBPF_STACK_SIZE>& live,
+                                 std::vector<variable_t>& dead) {
+    if (live.all()) {
+        return;
+    }
+    for (data_kind_t kind : {data_kind_t::types, data_kind_t::values, data_kind_t::offsets}) {
+        for (const cell_t& c : get_tracked_cells(inv, kind, 0, EBPF_STACK_SIZE - 1)) {
+            bool is_dead = c.get_offset() + c._size <= EBPF_STACK_SIZE;
+            for (offset_t i = c.get_offset(); is_dead && i < c.get_offset() + c._size; i++) {
+                is_dead = !live[i];
+            }
+            if (is_dead) {
+                dead.push_back(c.get_scalar(kind));
+            }
+        }
+    }
+    for (int i = 0; i < EBPF_STACK_SIZE; i++) {
+        if (!live[i]) {
+            int j = i;
+            while (j < EBPF_STACK_SIZE && !live[j]) {
+                j++;
+            }
+            num_bytes.havoc(i, j - i);
+            i = j;
+        }
+    }
+}
+
 std::optional<variable_t> array_domain_t::store(NumAbsDomain& inv, data_kind_t kind,
                                                 const linear_expression_t& idx,
                                                 const linear_expression_t& elem_size,
@@ -354,8 +232,7 @@ std::optional<variable_t> array_domain_t::store(NumAbsDomain& inv, data_kind_t k
             else
                 num_bytes.havoc(offset, size);
         }
-        variable_t v = lookup_array_map(kind).mk_cell(offset, size).get_scalar(kind);
-        return v;
+        return cell_t(offset, size).get_scalar(kind);
     }
     return {};
 }
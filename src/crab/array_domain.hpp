@@ -27,20 +27,18 @@
 #include <bitset>
 #include <functional>
 #include <optional>
-#include <set>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include "boost/range/algorithm/set_algorithm.hpp"
-
 #include "crab/variable.hpp"
 #include "crab_utils/debug.hpp"
 #include "crab_utils/stats.hpp"
 
 #include "crab/interval.hpp"
 #include "crab/split_dbm.hpp"
-#include "crab_utils/patricia_trees.hpp"
+#ifdef TRACE_DOMAIN
+#include "crab/domain_trace.hpp"
+#endif
 
 #include "asm_ostream.hpp"
 #include "config.hpp"
@@ -53,7 +51,11 @@
 namespace crab::domains {
 
 // Numerical abstract domain.
+#ifdef TRACE_DOMAIN
+using NumAbsDomain = traced_domain_t<SplitDBM>;
+#else
 using NumAbsDomain = SplitDBM;
+#endif
 
 using offset_t = index_t;
 
@@ -64,20 +66,20 @@ using offset_t = index_t;
        _scalar = array[_offset, _offset + 1, ..., _offset + _size - 1]
 
    For simplicity, we don't carry the array inside the cell class.
-   Only, offset_map objects can create cells. They will consider the
-   array when generating the scalar variable.
+   Only array_domain_t can create cells. It will consider the array
+   when generating the scalar variable.
 */
 
-class offset_map_t;
+class array_domain_t;
 
 class cell_t final {
   private:
-    friend class offset_map_t;
+    friend class array_domain_t;
 
     offset_t _offset{};
     unsigned _size{};
 
-    // Only offset_map_t can create cells
+    // Only array_domain_t can create cells
     cell_t() = default;
 
     cell_t(offset_t offset, unsigned size) : _offset(offset), _size(size) {}
@@ -117,124 +119,31 @@ class cell_t final {
     }
 
     // Return true if [symb_lb, symb_ub] may overlap with the cell,
-    // where symb_lb and symb_ub are not constant expressions.
+    // where symb_lb and symb_ub are not constant expressions and range
+    // over lb_range and ub_range respectively.
     [[nodiscard]]
-    bool symbolic_overlap(const linear_expression_t& symb_lb,
-                          const linear_expression_t& symb_ub,
-                          const NumAbsDomain& dom) const;
+    bool symbolic_overlap(const interval_t& lb_range, const interval_t& ub_range) const;
 
     friend std::ostream& operator<<(std::ostream& o, const cell_t& c) { return o << "cell(" << c.to_interval() << ")"; }
 };
 
-// forward declarations
-class array_domain_t;
-
-// Map offsets to cells
-class offset_map_t final {
-  private:
-    friend class array_domain_t;
-
-    using cell_set_t = std::set<cell_t>;
-
-    /*
-      The keys in the patricia tree are processing in big-endian
-      order. This means that the keys are sorted. Sortedness is
-      very important to efficiently perform operations such as
-      checking for overlap cells. Since keys are treated as bit
-      patterns, negative offsets can be used but they are treated
-      as large unsigned numbers.
-    */
-    using patricia_tree_t = patricia_tree<offset_t, cell_set_t>;
-    using partial_order_t = typename patricia_tree_t::partial_order_t;
-
-    patricia_tree_t _map;
-
-    // for algorithm::lower_bound and algorithm::upper_bound
-    struct compare_binding_t {
-        bool operator()(const typename patricia_tree_t::binding_t& kv, const offset_t& o) const { return kv.first < o; }
-        bool operator()(const offset_t& o, const typename patricia_tree_t::binding_t& kv) const { return o < kv.first; }
-        bool operator()(const typename patricia_tree_t::binding_t& kv1,
-                        const typename patricia_tree_t::binding_t& kv2) const {
-            return kv1.first < kv2.first;
-        }
-    };
-
-    class domain_po : public partial_order_t {
-        bool leq(cell_set_t x, cell_set_t y) override {
-            {
-                cell_set_t z;
-                boost::set_difference(x, y, std::inserter(z, z.end()));
-                return z.empty();
-            }
-        }
-        // default value is bottom (i.e., empty map)
-        bool default_is_top() override { return false; }
-    }; // class domain_po
-
-    explicit offset_map_t(const patricia_tree_t& m) : _map(m) {}
-
-    void remove_cell(const cell_t& c);
-
-    void insert_cell(const cell_t& c);
-
-    [[nodiscard]] std::optional<cell_t> get_cell(offset_t o, unsigned size) const;
-
-    cell_t mk_cell(offset_t o, unsigned size);
-
-  public:
-    offset_map_t() = default;
-
-    [[nodiscard]] bool empty() const { return _map.empty(); }
-
-    [[nodiscard]] std::size_t size() const { return _map.size(); }
-
-    // leq operator
-    bool operator<=(const offset_map_t& o) const {
-        domain_po po;
-        return _map.leq(o._map, po);
-    }
-
-    void operator-=(const cell_t& c) { remove_cell(c); }
-
-    void operator-=(const std::vector<cell_t>& cells) {
-        for (auto c : cells) {
-            this->operator-=(c);
-        }
-    }
-
-    // Return in out all cells that might overlap with (o, size).
-    std::vector<cell_t> get_overlap_cells(offset_t o, unsigned size);
-
-    [[nodiscard]] std::vector<cell_t> get_overlap_cells_symbolic_offset(const NumAbsDomain& dom,
-                                                                        const linear_expression_t& symb_lb,
-                                                                        const linear_expression_t& symb_ub) const;
-
-    friend std::ostream& operator<<(std::ostream& o, const offset_map_t& m);
-
-    /* Operations needed if used as value in a separate_domain */
-    bool operator==(const offset_map_t& o) const { return *this <= o && o <= *this; }
-    [[nodiscard]] bool is_top() const { return empty(); }
-    [[nodiscard]] bool is_bottom() const { return false; }
-    /*
-       We don't distinguish between bottom and top.
-       This is fine because separate_domain only calls bottom if
-       operator[] is called over a bottom state. Thus, we will make
-       sure that we don't call operator[] in that case.
-    */
-    static offset_map_t bottom() { return offset_map_t(); }
-    static offset_map_t top() { return offset_map_t(); }
-};
-
-// We use a global array map
-using array_map_t = std::unordered_map<data_kind_t, offset_map_t>;
-extern array_map_t global_array_map;
-void clear_global_state();
-
 class array_domain_t final {
     bitset_domain_t num_bytes;
 
   private:
-    static offset_map_t& lookup_array_map(data_kind_t kind) { return global_array_map[kind]; }
+    // There is no separate registry of cells: the cells of a state are
+    // exactly those whose scalar variables the numerical domain tracks.
+    // A cell that is not tracked holds an unknown value, and forgetting
+    // its scalar is all it takes to remove it.
+    static std::vector<cell_t> get_tracked_cells(const NumAbsDomain& inv, data_kind_t kind, offset_t lb, offset_t ub);
+
+    // Return all cells that might overlap with (o, size).
+    static std::vector<cell_t> get_overlap_cells(const NumAbsDomain& inv, data_kind_t kind, offset_t o,
+                                                 unsigned size);
+
+    static std::vector<cell_t> get_overlap_cells_symbolic_offset(const NumAbsDomain& inv, data_kind_t kind,
+                                                                 const linear_expression_t& symb_lb,
+                                                                 const linear_expression_t& symb_ub);
 
     static std::optional<std::pair<offset_t, unsigned>>
     kill_and_find_var(NumAbsDomain& inv, data_kind_t kind, const linear_expression_t& i, const linear_expression_t& elem_size);
@@ -254,9 +163,9 @@ class array_domain_t final {
 
     [[nodiscard]] bool is_top() const { return num_bytes.is_top(); }
 
-    bool operator<=(const array_domain_t& other) { return num_bytes <= other.num_bytes; }
+    bool operator<=(const array_domain_t& other) const { return num_bytes <= other.num_bytes; }
 
-    bool operator==(const array_domain_t& other) {
+    bool operator==(const array_domain_t& other) const {
         return num_bytes == other.num_bytes;
     }
 
@@ -310,6 +219,11 @@ class array_domain_t final {
         }
     }
 
+    // Forget the cells of every kind that lie entirely within bytes that are
+    // not live, adding their scalars to dead, and forget whether those bytes
+    // hold numbers.
+    void forget_dead(const NumAbsDomain& inv, const std::bitset<EBPF_STACK_SIZE>& live, std::vector<variable_t>& dead);
+
     // Perform array stores over an array segment
     void store_numbers(NumAbsDomain& inv, variable_t _idx, variable_t _width) {
 
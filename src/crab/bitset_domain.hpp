@@ -1,77 +1,125 @@
 // Copyright (c) Prevail Verifier contributors.
 // SPDX-License-Identifier: MIT
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <bitset>
+#include <cstdint>
+#include <functional>
 
 #include "spec_type_descriptors.hpp" // for EBPF_STACK_SIZE
 
 class bitset_domain_t final {
   private:
-    using bits_t = std::bitset<EBPF_STACK_SIZE>;
+    static constexpr size_t n_bytes = EBPF_STACK_SIZE;
+    static constexpr size_t word_size = 64;
+    static constexpr size_t n_words = n_bytes / word_size;
+    static_assert(n_bytes % word_size == 0);
+
+    // Bit i of word w is set iff byte w * 64 + i might not be numerical.
+    using bits_t = std::array<uint64_t, n_words>;
     bits_t non_numerical_bytes;
 
+    static bits_t all_ones() {
+        bits_t bits;
+        bits.fill(~uint64_t{0});
+        return bits;
+    }
+
+    [[nodiscard]] bool test(size_t i) const { return (non_numerical_bytes[i / word_size] >> (i % word_size)) & 1; }
+
+    // Call f(w, mask) for every word w overlapping the bytes [lb, ub),
+    // where mask selects the bytes of the range that fall within w.
+    template <typename F>
+    static void for_each_word(size_t lb, size_t ub, F f) {
+        for (size_t w = lb / word_size; w * word_size < ub; w++) {
+            size_t from = std::max(lb, w * word_size) - w * word_size;
+            size_t to = std::min(ub, (w + 1) * word_size) - w * word_size;
+            uint64_t mask = (to - from == word_size) ? ~uint64_t{0} : ((uint64_t{1} << (to - from)) - 1) << from;
+            f(w, mask);
+        }
+    }
+
+    template <typename Op>
+    [[nodiscard]] bits_t zip(const bitset_domain_t& other, Op op) const {
+        bits_t res;
+        for (size_t w = 0; w < n_words; w++) {
+            res[w] = op(non_numerical_bytes[w], other.non_numerical_bytes[w]);
+        }
+        return res;
+    }
+
   public:
-    bitset_domain_t() { non_numerical_bytes.set(); }
+    bitset_domain_t() : non_numerical_bytes{all_ones()} {}
 
     bitset_domain_t(bits_t non_numerical_bytes) : non_numerical_bytes{non_numerical_bytes} {}
 
-    void set_to_top() { non_numerical_bytes.set(); }
+    void set_to_top() { non_numerical_bytes = all_ones(); }
 
-    void set_to_bottom() { non_numerical_bytes.reset(); }
+    void set_to_bottom() { non_numerical_bytes.fill(0); }
 
-    [[nodiscard]] bool is_top() const { return non_numerical_bytes.all(); }
+    [[nodiscard]] bool is_top() const { return non_numerical_bytes == all_ones(); }
 
     [[nodiscard]] bool is_bottom() const { return false; }
 
-    bool operator<=(const bitset_domain_t& other) {
-        return (non_numerical_bytes | other.non_numerical_bytes) == other.non_numerical_bytes;
+    bool operator<=(const bitset_domain_t& other) const {
+        for (size_t w = 0; w < n_words; w++) {
+            if (non_numerical_bytes[w] & ~other.non_numerical_bytes[w]) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    bool operator==(const bitset_domain_t& other) { return non_numerical_bytes == other.non_numerical_bytes; }
+    bool operator==(const bitset_domain_t& other) const { return non_numerical_bytes == other.non_numerical_bytes; }
 
-    void operator|=(const bitset_domain_t& other) { non_numerical_bytes |= other.non_numerical_bytes; }
-
-    bitset_domain_t operator|(bitset_domain_t&& other) {
-        return non_numerical_bytes | other.non_numerical_bytes;
+    void operator|=(const bitset_domain_t& other) {
+        for (size_t w = 0; w < n_words; w++) {
+            non_numerical_bytes[w] |= other.non_numerical_bytes[w];
+        }
     }
 
-    bitset_domain_t operator|(const bitset_domain_t& other) {
-        return non_numerical_bytes | other.non_numerical_bytes;
-    }
+    bitset_domain_t operator|(bitset_domain_t&& other) { return zip(other, std::bit_or<>()); }
 
-    bitset_domain_t operator&(const bitset_domain_t& other) {
-        return non_numerical_bytes & other.non_numerical_bytes;
-    }
+    bitset_domain_t operator|(const bitset_domain_t& other) { return zip(other, std::bit_or<>()); }
 
-    bitset_domain_t widen(const bitset_domain_t& other) {
-        return non_numerical_bytes | other.non_numerical_bytes;
-    }
+    bitset_domain_t operator&(const bitset_domain_t& other) { return zip(other, std::bit_and<>()); }
 
-    bitset_domain_t narrow(const bitset_domain_t& other) {
-        return non_numerical_bytes & other.non_numerical_bytes;
-    }
+    bitset_domain_t widen(const bitset_domain_t& other) { return zip(other, std::bit_or<>()); }
 
+    bitset_domain_t narrow(const bitset_domain_t& other) { return zip(other, std::bit_and<>()); }
+
+    // Bytes outside the stack are neither known to be numbers nor known not to be.
     std::pair<bool, bool> uniformity(size_t lb, int width) {
+        if (width <= 0) {
+            return std::make_pair(true, true);
+        }
+        if (lb >= n_bytes || (size_t)width > n_bytes - lb) {
+            return std::make_pair(false, false);
+        }
         bool only_num = true;
         bool only_non_num = true;
-        for (int j = 0; j < width; j++) {
-            bool b = non_numerical_bytes[lb + j];
-            only_num &= !b;
-            only_non_num &= b;
-        }
+        for_each_word(lb, lb + width, [&](size_t w, uint64_t mask) {
+            uint64_t b = non_numerical_bytes[w] & mask;
+            only_num &= b == 0;
+            only_non_num &= b == mask;
+        });
         return std::make_pair(only_num, only_non_num);
     }
 
+    // Mark the bytes [lb, lb + n) as numerical. Bytes outside the stack are ignored.
     void reset(size_t lb, int n) {
-        for (int i = 0; i < n; i++) {
-            non_numerical_bytes.reset(lb + i);
+        if (n > 0 && lb < n_bytes) {
+            for_each_word(lb, std::min(lb + n, n_bytes),
+                          [&](size_t w, uint64_t mask) { non_numerical_bytes[w] &= ~mask; });
         }
     }
 
+    // Mark the bytes [lb, lb + width) as possibly non-numerical. Bytes outside the stack are ignored.
     void havoc(size_t lb, int width) {
-        for (int i = 0; i < width; i++) {
-            non_numerical_bytes.set(lb + i);
+        if (width > 0 && lb < n_bytes) {
+            for_each_word(lb, std::min(lb + width, n_bytes),
+                          [&](size_t w, uint64_t mask) { non_numerical_bytes[w] |= mask; });
         }
     }
 
@@ -80,12 +128,11 @@ class bitset_domain_t final {
     // Test whether all values in the range [lb,ub) are numerical.
     bool all_num(int lb, int ub) {
         assert(lb < ub);
-        if (lb < 0 || ub > (int)non_numerical_bytes.size())
+        if (lb < 0 || ub > (int)n_bytes)
             return false;
 
-        for (int i = lb; i < ub; i++)
-            if (non_numerical_bytes[i])
-                return false;
-        return true;
+        bool res = true;
+        for_each_word(lb, ub, [&](size_t w, uint64_t mask) { res &= (non_numerical_bytes[w] & mask) == 0; });
+        return res;
     }
 };
@@ -333,41 +333,6 @@ class cfg_t final {
 
     [[nodiscard]] size_t size() const { return static_cast<size_t>(std::distance(begin(), end())); }
 
-    void simplify() {
-        std::set<label_t> worklist(this->label_begin(), this->label_end());
-        while (!worklist.empty()) {
-            label_t label = *worklist.begin();
-            worklist.erase(label);
-
-            basic_block_t& bb = get_node(label);
-            if (bb.in_degree() == 1 && get_parent(label).out_degree() == 1) {
-                continue;
-            }
-            while (bb.out_degree() == 1) {
-                basic_block_t& next_bb = get_child(label);
-
-                if (&next_bb == &bb || next_bb.in_degree() != 1) {
-                    break;
-                }
-                if (next_bb.label() == exit_label()) {
-                    break;
-                }
-                worklist.erase(next_bb.label());
-
-                bb.move_back(next_bb);
-                bb -= next_bb;
-                auto children = next_bb.m_next;
-                for (const label_t& next_next_label : children) {
-                    basic_block_t& next_next_bb = get_node(next_next_label);
-                    bb >> next_next_bb;
-                }
-
-                // delete next_bb entirely
-                remove(next_bb.label());
-            }
-        }
-    }
-
     [[nodiscard]] std::vector<label_t> sorted_labels() const {
         std::vector<label_t> labels = this->labels();
         std::sort(labels.begin(), labels.end());
@@ -542,7 +507,7 @@ std::map<std::string, int> collect_stats(const cfg_t&);
 
 cfg_t prepare_cfg(const InstructionSeq& prog, const program_info& info, bool simplify);
 
-void explicate_assertions(cfg_t& cfg, const program_info& info);
+std::vector<Assert> get_assertions(const Instruction& ins, const program_info& info);
 
 void print_dot(const cfg_t& cfg, std::ostream& out);
 void print_dot(const cfg_t& cfg, const std::string& outfile);
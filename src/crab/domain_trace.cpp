@@ -0,0 +1,269 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <sstream>
+#include <stdexcept>
+
+#include "crab/domain_trace.hpp"
+
+namespace crab::domains {
+
+static constexpr char trace_magic[4] = {'P', 'V', 'D', 'T'};
+static constexpr char trace_version = 1;
+
+// Tags of numbers and bounds.
+enum : uint8_t { small_number, big_number, plus_infinity, minus_infinity };
+
+std::string name_of(trace_op_t op) {
+    switch (op) {
+    case trace_op_t::create_top: return "create_top";
+    case trace_op_t::create_bottom: return "create_bottom";
+    case trace_op_t::copy: return "copy";
+    case trace_op_t::drop: return "drop";
+    case trace_op_t::join: return "join";
+    case trace_op_t::widen: return "widen";
+    case trace_op_t::widen_thresholds: return "widen_thresholds";
+    case trace_op_t::meet: return "meet";
+    case trace_op_t::narrow: return "narrow";
+    case trace_op_t::leq: return "leq";
+    case trace_op_t::normalize: return "normalize";
+    case trace_op_t::forget_var: return "forget_var";
+    case trace_op_t::forget: return "forget";
+    case trace_op_t::rename: return "rename";
+    case trace_op_t::assign: return "assign";
+    case trace_op_t::apply_var: return "apply_var";
+    case trace_op_t::apply_const: return "apply_const";
+    case trace_op_t::add_constraint: return "add_constraint";
+    case trace_op_t::add_constraints: return "add_constraints";
+    case trace_op_t::set: return "set";
+    case trace_op_t::interval: return "interval";
+    case trace_op_t::eval_interval: return "eval_interval";
+    case trace_op_t::eval_relational: return "eval_relational";
+    case trace_op_t::eval_unit_interval: return "eval_unit_interval";
+    case trace_op_t::entail: return "entail";
+    case trace_op_t::intersect: return "intersect";
+    case trace_op_t::count: break;
+    }
+    return "unknown";
+}
+
+std::unique_ptr<trace_writer_t> trace_writer_t::instance;
+
+trace_writer_t::trace_writer_t(const std::string& path) : out(path, std::ios::binary) {
+    if (!out) {
+        throw std::runtime_error("Can't create trace file " + path);
+    }
+    out.write(trace_magic, sizeof(trace_magic));
+    out.put(trace_version);
+}
+
+void trace_writer_t::open(const std::string& path) { instance.reset(new trace_writer_t(path)); }
+
+void trace_writer_t::close() { instance.reset(); }
+
+void trace_writer_t::put_varint(uint64_t n) {
+    while (n >= 0x80) {
+        out.put((char)(n | 0x80));
+        n >>= 7;
+    }
+    out.put((char)n);
+}
+
+void trace_writer_t::put_number(const number_t& n, uint8_t small_tag, uint8_t big_tag) {
+    if (n.fits_slong()) {
+        int64_t v = (long)n;
+        out.put((char)small_tag);
+        // Zigzag encoding, so that small negative numbers stay short.
+        put_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    } else {
+        std::ostringstream s;
+        s << n;
+        out.put((char)big_tag);
+        put_varint(s.str().size());
+        out << s.str();
+    }
+}
+
+void trace_writer_t::put(const bound_t& b) {
+    if (b.is_plus_infinity()) {
+        out.put((char)plus_infinity);
+    } else if (b.is_minus_infinity()) {
+        out.put((char)minus_infinity);
+    } else {
+        put(*b.number());
+    }
+}
+
+void trace_writer_t::put(const interval_t& i) {
+    put(i.lb());
+    put(i.ub());
+}
+
+void trace_writer_t::put(const linear_expression_t& e) {
+    put_varint(e.size());
+    for (const auto& [v, n] : e) {
+        put(v);
+        put(n);
+    }
+    put(e.constant());
+}
+
+void trace_writer_t::put(const linear_constraint_t& cst) {
+    out.put((char)cst.kind());
+    put(cst.expression());
+}
+
+void trace_writer_t::put(const std::vector<variable_t>& vars) {
+    put_varint(vars.size());
+    for (variable_t v : vars) {
+        put(v);
+    }
+}
+
+void trace_writer_t::put(const std::vector<linear_constraint_t>& csts) {
+    put_varint(csts.size());
+    for (const linear_constraint_t& cst : csts) {
+        put(cst);
+    }
+}
+
+void trace_writer_t::put(binop_t op) {
+    // Arithmetic operators first, then bitwise ones.
+    if (auto arith = std::get_if<arith_binop_t>(&op)) {
+        out.put((char)*arith);
+    } else {
+        out.put((char)(0x10 | (int)std::get<bitwise_binop_t>(op)));
+    }
+}
+
+void trace_writer_t::put(const thresholds_t& ts) {
+    put_varint(ts.size());
+    for (const bound_t& b : ts) {
+        put(b);
+    }
+}
+
+trace_reader_t::trace_reader_t(std::istream& in) : in(in) {
+    char magic[sizeof(trace_magic)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), trace_magic) ||
+        in.get() != trace_version) {
+        throw std::runtime_error("Not a domain trace");
+    }
+}
+
+uint8_t trace_reader_t::get_byte() {
+    int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+        throw std::runtime_error("Truncated domain trace");
+    }
+    return (uint8_t)c;
+}
+
+uint64_t trace_reader_t::get_varint() {
+    uint64_t n = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = get_byte();
+        n |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return n;
+        }
+    }
+    throw std::runtime_error("Bad varint in domain trace");
+}
+
+std::optional<trace_op_t> trace_reader_t::next() {
+    int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+        return {};
+    }
+    if (c >= (int)trace_op_t::count) {
+        throw std::runtime_error("Bad operation in domain trace: " + std::to_string(c));
+    }
+    return (trace_op_t)c;
+}
+
+number_t trace_reader_t::get_number(uint8_t tag) {
+    switch (tag) {
+    case small_number: {
+        uint64_t z = get_varint();
+        return number_t((long)((z >> 1) ^ -(z & 1)));
+    }
+    case big_number: {
+        std::string s(get_varint(), '\0');
+        if (!in.read(s.data(), s.size())) {
+            throw std::runtime_error("Truncated domain trace");
+        }
+        return number_t(s);
+    }
+    default: throw std::runtime_error("Bad number in domain trace");
+    }
+}
+
+bound_t trace_reader_t::get_bound() {
+    switch (uint8_t tag = get_byte()) {
+    case plus_infinity: return bound_t::plus_infinity();
+    case minus_infinity: return bound_t::minus_infinity();
+    default: return bound_t{get_number(tag)};
+    }
+}
+
+interval_t trace_reader_t::get_interval() {
+    bound_t lb = get_bound();
+    return interval_t(lb, get_bound());
+}
+
+// The n remaining terms of an expression, then its constant.
+linear_expression_t trace_reader_t::get_terms(uint64_t n) {
+    if (n == 0) {
+        return linear_expression_t(get_number());
+    }
+    variable_t v = get_var();
+    number_t k = get_number();
+    return linear_expression_t(k, v) + get_terms(n - 1);
+}
+
+linear_expression_t trace_reader_t::get_expression() { return get_terms(get_varint()); }
+
+linear_constraint_t trace_reader_t::get_constraint() {
+    uint8_t kind = get_byte();
+    if (kind > (uint8_t)cst_kind::STRICT_INEQUALITY) {
+        throw std::runtime_error("Bad constraint in domain trace");
+    }
+    return linear_constraint_t(get_expression(), (cst_kind)kind);
+}
+
+std::vector<variable_t> trace_reader_t::get_vars() {
+    std::vector<variable_t> res;
+    for (uint64_t n = get_varint(); n > 0; n--) {
+        res.push_back(get_var());
+    }
+    return res;
+}
+
+std::vector<linear_constraint_t> trace_reader_t::get_constraints() {
+    std::vector<linear_constraint_t> res;
+    for (uint64_t n = get_varint(); n > 0; n--) {
+        res.push_back(get_constraint());
+    }
+    return res;
+}
+
+binop_t trace_reader_t::get_binop() {
+    uint8_t op = get_byte();
+    if (op & 0x10) {
+        return (bitwise_binop_t)(op & 0xf);
+    }
+    return (arith_binop_t)op;
+}
+
+thresholds_t trace_reader_t::get_thresholds() {
+    thresholds_t ts;
+    for (uint64_t n = get_varint(); n > 0; n--) {
+        bound_t b = get_bound();
+        if (b.is_finite()) {
+            ts.add(b);
+        }
+    }
+    return ts;
+}
+
+} // namespace crab::domains
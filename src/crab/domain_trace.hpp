@@ -0,0 +1,362 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/*
+ * Record and replay of numerical domain operations.
+ *
+ * When the verifier is built with TRACE_DOMAIN, NumAbsDomain is
+ * traced_domain_t<SplitDBM>, which forwards every call to the wrapped domain
+ * and appends it to a binary trace. Each domain value carries an id, so the
+ * operands of an operation are referred to by id instead of being copied
+ * into the trace. The trace can then be replayed against any domain with the
+ * SplitDBM interface, without the rest of the analysis (see src/main/replay.cpp).
+ *
+ * A trace is the magic "PVDT", a version byte, then a sequence of records:
+ * an operation code followed by its operands. Integers are LEB128 varints and
+ * numbers that do not fit in 64 bits are written in decimal.
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crab/interval.hpp"
+#include "crab/linear_constraints.hpp"
+#include "crab/split_dbm.hpp"
+#include "crab/thresholds.hpp"
+#include "crab/variable.hpp"
+
+namespace crab::domains {
+
+enum class trace_op_t : uint8_t {
+    create_top,         // id
+    create_bottom,      // id
+    copy,               // dst, src
+    drop,               // id
+    join,               // result, left, right
+    widen,              // result, left, right
+    widen_thresholds,   // result, left, right, thresholds
+    meet,               // result, left, right
+    narrow,             // result, left, right
+    leq,                // left, right, result
+    normalize,          // id
+    forget_var,         // id, x
+    forget,             // id, variables
+    rename,             // id, from, to
+    assign,             // id, x, expression
+    apply_var,          // id, op, x, y, z
+    apply_const,        // id, op, x, y, k
+    add_constraint,     // id, constraint
+    add_constraints,    // id, constraints
+    set,                // id, x, interval
+    interval,           // id, x
+    eval_interval,      // id, expression
+    eval_relational,    // id, expression
+    eval_unit_interval, // id, expression
+    entail,             // id, constraint, result
+    intersect,          // id, constraint, result
+    count
+};
+
+std::string name_of(trace_op_t op);
+
+class trace_writer_t final {
+    std::ofstream out;
+
+    static std::unique_ptr<trace_writer_t> instance;
+
+    explicit trace_writer_t(const std::string& path);
+
+    void put_varint(uint64_t n);
+    void put_number(const number_t& n, uint8_t small_tag, uint8_t big_tag);
+
+    void put(trace_op_t op) { out.put((char)op); }
+    void put(uint64_t id) { put_varint(id); }
+    void put(bool b) { out.put((char)b); }
+    void put(variable_t v) { put_varint(v.index()); }
+    void put(const number_t& n) { put_number(n, 0, 1); }
+    void put(const bound_t& b);
+    void put(const interval_t& i);
+    void put(const linear_expression_t& e);
+    void put(const linear_constraint_t& cst);
+    void put(const std::vector<variable_t>& vars);
+    void put(const std::vector<linear_constraint_t>& csts);
+    void put(binop_t op);
+    void put(const thresholds_t& ts);
+
+  public:
+    // Start recording to path. Throws std::runtime_error if it cannot be created.
+    static void open(const std::string& path);
+    static void close();
+
+    template <typename... Args>
+    static void record(trace_op_t op, const Args&... args) {
+        if (instance) {
+            instance->put(op);
+            (instance->put(args), ...);
+        }
+    }
+};
+
+class trace_reader_t final {
+    std::istream& in;
+
+    uint64_t get_varint();
+    uint8_t get_byte();
+    number_t get_number(uint8_t tag);
+    linear_expression_t get_terms(uint64_t n);
+
+  public:
+    // Throws std::runtime_error if in does not start with a trace header.
+    explicit trace_reader_t(std::istream& in);
+
+    // Return the next operation code, or nothing at the end of the trace.
+    std::optional<trace_op_t> next();
+
+    uint64_t get_id() { return get_varint(); }
+    bool get_bool() { return get_byte() != 0; }
+    variable_t get_var() { return variable_t::of_index(get_varint()); }
+    number_t get_number() { return get_number(get_byte()); }
+    bound_t get_bound();
+    interval_t get_interval();
+    linear_expression_t get_expression();
+    linear_constraint_t get_constraint();
+    std::vector<variable_t> get_vars();
+    std::vector<linear_constraint_t> get_constraints();
+    binop_t get_binop();
+    thresholds_t get_thresholds();
+};
+
+// A numerical domain that records each operation made on it. Moving a value
+// moves its id along; copying it records a copy under a fresh id.
+template <typename Dom>
+class traced_domain_t final {
+    using variable_vector_t = std::vector<variable_t>;
+
+    Dom dom;
+    uint64_t id{};
+
+    static uint64_t fresh_id() {
+        static uint64_t last = 0;
+        return ++last;
+    }
+
+    traced_domain_t(Dom dom, uint64_t id) : dom(std::move(dom)), id(id) {}
+
+    traced_domain_t result(Dom res, trace_op_t op, const traced_domain_t& o) const {
+        traced_domain_t r{std::move(res), fresh_id()};
+        trace_writer_t::record(op, r.id, id, o.id);
+        return r;
+    }
+
+    void drop() {
+        if (id) {
+            trace_writer_t::record(trace_op_t::drop, id);
+        }
+    }
+
+  public:
+    explicit traced_domain_t(bool is_bottom = false)
+        : dom(is_bottom ? Dom::bottom() : Dom::top()), id(fresh_id()) {
+        trace_writer_t::record(is_bottom ? trace_op_t::create_bottom : trace_op_t::create_top, id);
+    }
+
+    traced_domain_t(const traced_domain_t& o) : dom(o.dom), id(fresh_id()) {
+        trace_writer_t::record(trace_op_t::copy, id, o.id);
+    }
+
+    traced_domain_t(traced_domain_t&& o) noexcept : dom(std::move(o.dom)), id(o.id) { o.id = 0; }
+
+    traced_domain_t& operator=(const traced_domain_t& o) {
+        if (this != &o) {
+            dom = o.dom;
+            if (!id) {
+                id = fresh_id();
+            }
+            trace_writer_t::record(trace_op_t::copy, id, o.id);
+        }
+        return *this;
+    }
+
+    traced_domain_t& operator=(traced_domain_t&& o) noexcept {
+        if (this != &o) {
+            drop();
+            dom = std::move(o.dom);
+            id = o.id;
+            o.id = 0;
+        }
+        return *this;
+    }
+
+    ~traced_domain_t() { drop(); }
+
+    static traced_domain_t top() { return traced_domain_t(false); }
+
+    static traced_domain_t bottom() { return traced_domain_t(true); }
+
+    void set_to_top() { *this = top(); }
+
+    void set_to_bottom() { *this = bottom(); }
+
+    bool is_bottom() const { return dom.is_bottom(); }
+
+    bool is_top() const { return dom.is_top(); }
+
+    bool operator<=(const traced_domain_t& o) {
+        bool res = dom <= o.dom;
+        trace_writer_t::record(trace_op_t::leq, id, o.id, res);
+        return res;
+    }
+
+    void operator|=(const traced_domain_t& o) {
+        dom |= o.dom;
+        trace_writer_t::record(trace_op_t::join, id, id, o.id);
+    }
+
+    void operator|=(traced_domain_t&& o) {
+        dom |= std::move(o.dom);
+        trace_writer_t::record(trace_op_t::join, id, id, o.id);
+    }
+
+    traced_domain_t operator|(const traced_domain_t& o) & { return result(dom | o.dom, trace_op_t::join, o); }
+
+    traced_domain_t operator|(const traced_domain_t& o) && {
+        return result(std::move(dom) | o.dom, trace_op_t::join, o);
+    }
+
+    traced_domain_t widen(const traced_domain_t& o) { return result(dom.widen(o.dom), trace_op_t::widen, o); }
+
+    traced_domain_t widening_thresholds(const traced_domain_t& o, const thresholds_t& ts) {
+        traced_domain_t r{dom.widening_thresholds(o.dom, ts), fresh_id()};
+        trace_writer_t::record(trace_op_t::widen_thresholds, r.id, id, o.id, ts);
+        return r;
+    }
+
+    traced_domain_t operator&(const traced_domain_t& o) { return result(dom & o.dom, trace_op_t::meet, o); }
+
+    traced_domain_t narrow(const traced_domain_t& o) { return result(dom.narrow(o.dom), trace_op_t::narrow, o); }
+
+    void normalize() {
+        dom.normalize();
+        trace_writer_t::record(trace_op_t::normalize, id);
+    }
+
+    void operator-=(variable_t v) {
+        dom -= v;
+        trace_writer_t::record(trace_op_t::forget_var, id, v);
+    }
+
+    void assign(variable_t x, const linear_expression_t& e) {
+        dom.assign(x, e);
+        trace_writer_t::record(trace_op_t::assign, id, x, e);
+    }
+
+    void assign(std::optional<variable_t> x, const linear_expression_t& e) {
+        if (x) {
+            assign(*x, e);
+        }
+    }
+
+    void assign(variable_t x, signed long long int n) { assign(x, linear_expression_t(n)); }
+
+    void assign(variable_t x, variable_t v) { assign(x, linear_expression_t{v}); }
+
+    void assign(variable_t x, const std::optional<linear_expression_t>& e) {
+        if (e) {
+            assign(x, *e);
+        } else {
+            *this -= x;
+        }
+    }
+
+    void apply(binop_t op, variable_t x, variable_t y, const number_t& k) {
+        dom.apply(op, x, y, k);
+        trace_writer_t::record(trace_op_t::apply_const, id, op, x, y, k);
+    }
+
+    void apply(binop_t op, variable_t x, variable_t y, variable_t z) {
+        dom.apply(op, x, y, z);
+        trace_writer_t::record(trace_op_t::apply_var, id, op, x, y, z);
+    }
+
+    void apply(arith_binop_t op, variable_t x, variable_t y, variable_t z) { apply(binop_t{op}, x, y, z); }
+
+    void apply(arith_binop_t op, variable_t x, variable_t y, const number_t& k) { apply(binop_t{op}, x, y, k); }
+
+    void apply(bitwise_binop_t op, variable_t x, variable_t y, variable_t z) { apply(binop_t{op}, x, y, z); }
+
+    void apply(bitwise_binop_t op, variable_t x, variable_t y, const number_t& k) { apply(binop_t{op}, x, y, k); }
+
+    void operator+=(const linear_constraint_t& cst) {
+        dom += cst;
+        trace_writer_t::record(trace_op_t::add_constraint, id, cst);
+    }
+
+    void operator+=(const std::vector<linear_constraint_t>& csts) {
+        dom += csts;
+        trace_writer_t::record(trace_op_t::add_constraints, id, csts);
+    }
+
+    interval_t eval_interval(const linear_expression_t& e) const {
+        trace_writer_t::record(trace_op_t::eval_interval, id, e);
+        return dom.eval_interval(e);
+    }
+
+    interval_t eval_relational_interval(const linear_expression_t& e) const {
+        trace_writer_t::record(trace_op_t::eval_relational, id, e);
+        return dom.eval_relational_interval(e);
+    }
+
+    std::optional<interval_t> eval_unit_interval(const linear_expression_t& e) {
+        trace_writer_t::record(trace_op_t::eval_unit_interval, id, e);
+        return dom.eval_unit_interval(e);
+    }
+
+    template <typename F>
+    void for_each_variable(variable_t lb, variable_t ub, F f) const {
+        dom.for_each_variable(lb, ub, f);
+    }
+
+    interval_t operator[](variable_t x) const {
+        trace_writer_t::record(trace_op_t::interval, id, x);
+        return dom[x];
+    }
+
+    void set(variable_t x, const interval_t& intv) {
+        dom.set(x, intv);
+        trace_writer_t::record(trace_op_t::set, id, x, intv);
+    }
+
+    void forget(const variable_vector_t& variables) {
+        dom.forget(variables);
+        trace_writer_t::record(trace_op_t::forget, id, variables);
+    }
+
+    void rename(const variable_vector_t& from, const variable_vector_t& to) {
+        dom.rename(from, to);
+        trace_writer_t::record(trace_op_t::rename, id, from, to);
+    }
+
+    std::pair<std::size_t, std::size_t> size() const { return dom.size(); }
+
+    bool intersect(const linear_constraint_t& cst) {
+        bool res = dom.intersect(cst);
+        trace_writer_t::record(trace_op_t::intersect, id, cst, res);
+        return res;
+    }
+
+    bool entail(const linear_constraint_t& cst) {
+        bool res = dom.entail(cst);
+        trace_writer_t::record(trace_op_t::entail, id, cst, res);
+        return res;
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, traced_domain_t& d) { return o << d.dom; }
+};
+
+} // namespace crab::domains
@@ -29,6 +29,7 @@
 #include "platform.hpp"
 
 #include "crab/array_domain.hpp"
+#include "crab/liveness.hpp"
 
 namespace crab::domains {
 
@@ -137,10 +138,351 @@ inline bool is_unsigned_cmp(Condition::Op op) {
     return {};
 }
 
+/// The register types a type variable may hold, as a finite set with one
+/// element per type and a single element for all shared regions.
+class type_set_t final {
+    uint8_t bits{};
+
+    static constexpr int shared_index = T_SHARED - T_UNINIT;
+
+  public:
+    explicit type_set_t(const interval_t& types) {
+        for (int t = T_UNINIT; t < T_SHARED; t++) {
+            if (types[t]) {
+                bits |= 1 << (t - T_UNINIT);
+            }
+        }
+        if (types.ub() > T_SHARED) {
+            bits |= 1 << shared_index;
+        }
+    }
+
+    [[nodiscard]] bool contains(int type) const { return bits & (1 << (type - T_UNINIT)); }
+
+    [[nodiscard]] bool may_be_shared() const { return bits & (1 << shared_index); }
+};
+
+/// Steps of the transfer function of a basic block, with the variables,
+/// constants and constraints of each instruction already resolved.
+namespace micro {
+
+/// x := k
+struct assign_const_t {
+    variable_t x;
+    int k;
+};
+
+/// x := y
+struct assign_var_t {
+    variable_t x;
+    variable_t y;
+};
+
+/// Forget everything about x.
+struct havoc_t {
+    variable_t x;
+};
+
+/// Forget everything about each of xs at once.
+struct forget_t {
+    std::vector<variable_t> xs;
+};
+
+/// x := x op k, forgetting x on overflow if finite_width.
+struct apply_const_t {
+    binop_t op;
+    variable_t x;
+    number_t k;
+    bool finite_width{};
+};
+
+/// x := x op y, forgetting x on overflow if finite_width.
+struct apply_var_t {
+    binop_t op;
+    variable_t x;
+    variable_t y;
+    bool finite_width{};
+};
+
+struct assume_t {
+    linear_constraint_t cst;
+};
+
+/// Add several constraints at once.
+struct assume_all_t {
+    std::vector<linear_constraint_t> csts;
+};
+
+/// Require each constraint in turn, reporting message on failure.
+struct check_t {
+    std::vector<linear_constraint_t> csts;
+    std::string message;
+};
+
+/// Load width bytes at addr on the stack into target.
+struct stack_load_t {
+    reg_pack_t target;
+    linear_expression_t addr;
+    int width;
+};
+
+/// Any other instruction, whose transfer function depends on the state.
+struct transfer_t {
+    Instruction ins;
+};
+
+} // namespace micro
+
+using micro_op_t = std::variant<micro::assign_const_t, micro::assign_var_t, micro::havoc_t, micro::forget_t,
+                                micro::apply_const_t, micro::apply_var_t, micro::assume_t, micro::assume_all_t, micro::check_t,
+                                micro::stack_load_t, micro::transfer_t>;
+
+/// A basic block lowered to micro operations, so that resolving the
+/// instructions is done once rather than in every fixpoint iteration.
+struct lowered_block_t {
+    std::vector<micro_op_t> ops;
+    // The number of instructions of the original block.
+    size_t size{};
+};
+
+/// Lower each instruction to the micro operations that ebpf_domain_t
+/// would otherwise perform for it, in the same order.
+class lowering_t final {
+    std::vector<micro_op_t>& ops;
+
+    void no_pointer(reg_pack_t reg) {
+        ops.emplace_back(micro::assign_const_t{reg.type, T_NUM});
+        ops.emplace_back(micro::havoc_t{reg.offset});
+    }
+
+    void apply(binop_t op, variable_t x, const number_t& k, bool finite_width = false) {
+        ops.emplace_back(micro::apply_const_t{op, x, k, finite_width});
+    }
+
+    void apply(binop_t op, variable_t x, variable_t y, bool finite_width = false) {
+        ops.emplace_back(micro::apply_var_t{op, x, y, finite_width});
+    }
+
+    template <typename T>
+    void transfer(const T& ins) {
+        ops.emplace_back(micro::transfer_t{ins});
+    }
+
+    static std::vector<linear_constraint_t> type_constraints(variable_t t, TypeGroup types) {
+        using namespace dsl_syntax;
+        switch (types) {
+        case TypeGroup::number: return {t == T_NUM};
+        case TypeGroup::map_fd: return {t == T_MAP};
+        case TypeGroup::ctx: return {t == T_CTX};
+        case TypeGroup::packet: return {t == T_PACKET};
+        case TypeGroup::stack: return {t == T_STACK};
+        case TypeGroup::shared: return {t > T_SHARED};
+        case TypeGroup::non_map_fd: return {t >= T_NUM};
+        case TypeGroup::mem: return {t >= T_STACK};
+        case TypeGroup::mem_or_num: return {t >= T_NUM, t != T_CTX};
+        case TypeGroup::pointer: return {t >= T_CTX};
+        case TypeGroup::ptr_or_num: return {t >= T_NUM};
+        case TypeGroup::stack_or_packet: return {t >= T_STACK, t <= T_PACKET};
+        }
+        return {};
+    }
+
+  public:
+    explicit lowering_t(std::vector<micro_op_t>& ops) : ops(ops) {}
+
+    void operator()(const Undefined&) {}
+    void operator()(const Exit&) {}
+    void operator()(const Jmp&) {}
+    void operator()(const LockAdd&) {}
+
+    void operator()(const Call& call) { transfer(call); }
+
+    void operator()(const Assume& s) {
+        if (std::holds_alternative<Reg>(s.cond.right) || s.cond.op == Condition::Op::SET) {
+            transfer(s);
+            return;
+        }
+        int imm = static_cast<int>(std::get<Imm>(s.cond.right).v);
+        ops.emplace_back(micro::assume_all_t{jmp_to_cst_imm(s.cond.op, reg_pack(s.cond.left).value, imm)});
+    }
+
+    void operator()(const Un& stmt) {
+        auto dst = reg_pack(stmt.dst);
+        switch (stmt.op) {
+        case Un::Op::LE16:
+        case Un::Op::LE32:
+        case Un::Op::LE64: ops.emplace_back(micro::havoc_t{dst.value}); break;
+        case Un::Op::NEG: apply(arith_binop_t::MUL, dst.value, (number_t)-1, true); break;
+        }
+        no_pointer(dst);
+    }
+
+    void operator()(const LoadMapFd& ins) {
+        auto dst = reg_pack(ins.dst);
+        ops.emplace_back(micro::assign_const_t{dst.type, T_MAP});
+        ops.emplace_back(micro::assign_const_t{dst.value, ins.mapfd});
+        ops.emplace_back(micro::havoc_t{dst.offset});
+    }
+
+    void operator()(const Packet&) {
+        std::vector<variable_t> scratched;
+        for (int i = R0_RETURN_VALUE; i <= R5_ARG; i++) {
+            auto reg = reg_pack(i);
+            scratched.insert(scratched.end(), {reg.value, reg.offset, reg.type});
+        }
+        ops.emplace_back(micro::forget_t{std::move(scratched)});
+        ops.emplace_back(micro::assign_const_t{reg_pack(R0_RETURN_VALUE).type, T_NUM});
+    }
+
+    void operator()(const Mem& b) {
+        if (b.is_load && b.access.basereg.v == R10_STACK_POINTER) {
+            using namespace dsl_syntax;
+            linear_expression_t addr = reg_pack(R10_STACK_POINTER).offset + (number_t)b.access.offset;
+            ops.emplace_back(micro::stack_load_t{reg_pack(std::get<Reg>(b.value)), addr, b.access.width});
+        } else {
+            transfer(b);
+        }
+    }
+
+    void operator()(const Bin& bin) {
+        using namespace dsl_syntax;
+        auto dst = reg_pack(bin.dst);
+        if (std::holds_alternative<Imm>(bin.v)) {
+            int imm = static_cast<int>(std::get<Imm>(bin.v).v);
+            switch (bin.op) {
+            case Bin::Op::MOV:
+                ops.emplace_back(micro::assign_const_t{dst.value, imm});
+                no_pointer(dst);
+                break;
+            case Bin::Op::ADD:
+                if (imm == 0)
+                    return;
+                apply(arith_binop_t::ADD, dst.value, imm, true);
+                apply(arith_binop_t::ADD, dst.offset, imm);
+                break;
+            case Bin::Op::SUB:
+                if (imm == 0)
+                    return;
+                apply(arith_binop_t::SUB, dst.value, imm, true);
+                apply(arith_binop_t::SUB, dst.offset, imm);
+                break;
+            case Bin::Op::MUL:
+                apply(arith_binop_t::MUL, dst.value, imm, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::DIV:
+                apply(arith_binop_t::SDIV, dst.value, imm, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::MOD:
+                apply(arith_binop_t::SREM, dst.value, imm, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::OR:
+                apply(bitwise_binop_t::OR, dst.value, imm);
+                no_pointer(dst);
+                break;
+            case Bin::Op::AND:
+                apply(bitwise_binop_t::AND, dst.value, imm);
+                if ((int32_t)imm > 0) {
+                    ops.emplace_back(micro::assume_t{dst.value <= imm});
+                    ops.emplace_back(micro::assume_t{0 <= dst.value});
+                }
+                no_pointer(dst);
+                break;
+            case Bin::Op::LSH:
+                apply(bitwise_binop_t::SHL, dst.value, imm, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::RSH:
+            case Bin::Op::ARSH:
+                ops.emplace_back(micro::havoc_t{dst.value});
+                no_pointer(dst);
+                break;
+            case Bin::Op::XOR:
+                apply(bitwise_binop_t::XOR, dst.value, imm);
+                no_pointer(dst);
+                break;
+            }
+        } else {
+            auto src = reg_pack(std::get<Reg>(bin.v));
+            switch (bin.op) {
+            case Bin::Op::ADD:
+            case Bin::Op::SUB:
+                // Depends on the types of the operands.
+                transfer(bin);
+                return;
+            case Bin::Op::MUL:
+                apply(arith_binop_t::MUL, dst.value, src.value, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::DIV:
+                apply(arith_binop_t::SDIV, dst.value, src.value, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::MOD:
+                apply(arith_binop_t::SREM, dst.value, src.value, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::OR:
+                apply(bitwise_binop_t::OR, dst.value, src.value);
+                no_pointer(dst);
+                break;
+            case Bin::Op::AND:
+                apply(bitwise_binop_t::AND, dst.value, src.value);
+                no_pointer(dst);
+                break;
+            case Bin::Op::LSH:
+                apply(bitwise_binop_t::SHL, dst.value, src.value, true);
+                no_pointer(dst);
+                break;
+            case Bin::Op::RSH:
+            case Bin::Op::ARSH:
+                ops.emplace_back(micro::havoc_t{dst.value});
+                no_pointer(dst);
+                break;
+            case Bin::Op::XOR:
+                apply(bitwise_binop_t::XOR, dst.value, src.value);
+                no_pointer(dst);
+                break;
+            case Bin::Op::MOV:
+                ops.emplace_back(micro::assign_var_t{dst.value, src.value});
+                ops.emplace_back(micro::assign_var_t{dst.offset, src.offset});
+                ops.emplace_back(micro::assign_var_t{dst.type, src.type});
+                break;
+            }
+        }
+        if (!bin.is64) {
+            apply(bitwise_binop_t::AND, dst.value, UINT32_MAX);
+        }
+    }
+
+    void operator()(const Assert& stmt) { std::visit(*this, stmt.cst); }
+
+    void operator()(const Comparable& s) {
+        ops.emplace_back(micro::check_t{{eq(reg_pack(s.r1).type, reg_pack(s.r2).type)}, to_string(s)});
+    }
+
+    void operator()(const ValidSize& s) {
+        using namespace dsl_syntax;
+        auto r = reg_pack(s.reg);
+        ops.emplace_back(micro::check_t{{s.can_be_zero ? r.value >= 0 : r.value > 0}, to_string(s)});
+    }
+
+    void operator()(const TypeConstraint& s) {
+        ops.emplace_back(micro::check_t{type_constraints(reg_pack(s.reg).type, s.types), to_string(s)});
+    }
+
+    void operator()(const Addable& s) { transfer(Assert{s}); }
+    void operator()(const ValidAccess& s) { transfer(Assert{s}); }
+    void operator()(const ValidStore& s) { transfer(Assert{s}); }
+    void operator()(const ValidMapKeyValue& s) { transfer(Assert{s}); }
+};
+
 class ebpf_domain_t final {
   public:
     using variable_vector_t = std::vector<variable_t>;
-    typedef void check_require_func_t(NumAbsDomain&, const linear_constraint_t&, std::string);
+    typedef void check_require_func_t(NumAbsDomain&, const linear_constraint_t&, const std::string&);
 
   private:
     /// Mapping from variables (including registers, types, offsets,
@@ -186,8 +528,9 @@ class ebpf_domain_t final {
 
     bool is_top() const { return m_inv.is_top() && stack.is_top(); }
 
+    // The stack is compared word by word, so check it before the DBM.
     bool operator<=(const ebpf_domain_t& other) {
-        return m_inv <= other.m_inv && stack <= other.stack;
+        return stack <= other.stack && m_inv <= other.m_inv;
     }
 
     bool operator==(ebpf_domain_t other) {
@@ -247,8 +590,26 @@ class ebpf_domain_t final {
         m_inv.forget(variables);
     }
 
+    /// Forget all registers and stack bytes that are not live.
+    void forget_dead(const live_vars_t& live) {
+        if (is_bottom()) {
+            return;
+        }
+        variable_vector_t dead;
+        for (int i = R0_RETURN_VALUE; i < R10_STACK_POINTER; i++) {
+            if (!live.regs[i]) {
+                auto reg = reg_pack(i);
+                dead.insert(dead.end(), {reg.value, reg.offset, reg.type});
+            }
+        }
+        stack.forget_dead(m_inv, live.stack, dead);
+        m_inv.forget(dead);
+    }
+
     void operator+=(const linear_constraint_t& cst) { m_inv += cst; }
 
+    void operator+=(const std::vector<linear_constraint_t>& csts) { m_inv += csts; }
+
     void operator-=(variable_t var) { m_inv -= var; }
 
     void assign(variable_t x, const linear_expression_t& e) { m_inv.assign(x, e); }
@@ -276,13 +637,40 @@ class ebpf_domain_t final {
         return inv;
     }
 
+    /// One case of a split on the type of a register: the transformer is
+    /// applied to the part of the state where cond holds, if possible.
+    struct type_case_t {
+        bool possible;
+        linear_constraint_t cond;
+        std::function<NumAbsDomain(NumAbsDomain)> transformer;
+    };
+
+    /// Join the results of all possible cases. The state is only copied when
+    /// more than one case is possible.
+    static NumAbsDomain split_on_type(NumAbsDomain inv, const std::vector<type_case_t>& cases) {
+        NumAbsDomain res = NumAbsDomain::bottom();
+        auto last = std::find_if(cases.rbegin(), cases.rend(), [](const type_case_t& c) { return c.possible; });
+        for (auto it = cases.begin(); last != cases.rend() && it != last.base(); ++it) {
+            if (!it->possible) {
+                continue;
+            }
+            if (it == std::prev(last.base())) {
+                res |= it->transformer(when(std::move(inv), it->cond));
+            } else {
+                res |= it->transformer(when(inv, it->cond));
+            }
+        }
+        return res;
+    }
+
+    /// Forget r0 to r5, which helper calls clobber. The caller then sets r0.
     void scratch_caller_saved_registers() {
-        for (int i = R1_ARG; i <= R5_ARG; i++) {
+        variable_vector_t scratched;
+        for (int i = R0_RETURN_VALUE; i <= R5_ARG; i++) {
             auto reg = reg_pack(i);
-            havoc(reg.value);
-            havoc(reg.offset);
-            havoc(reg.type);
+            scratched.insert(scratched.end(), {reg.value, reg.offset, reg.type});
         }
+        m_inv.forget(scratched);
     }
 
     void apply(NumAbsDomain& inv, binop_t op, variable_t x, variable_t y, const number_t& z, bool finite_width = false) {
@@ -335,15 +723,18 @@ class ebpf_domain_t final {
     void assume(const linear_constraint_t& cst) { assume(m_inv, cst); }
     static void assume(NumAbsDomain& inv, const linear_constraint_t& cst) { inv += cst; }
 
-    void require(NumAbsDomain& inv, const linear_constraint_t& cst, std::string s) {
+    void require(NumAbsDomain& inv, const linear_constraint_t& cst, const std::string& s) {
         if (check_require)
-            check_require(inv, cst, std::move(s));
+            check_require(inv, cst, s);
         assume(inv, cst);
     }
 
     /// Forget everything we know about the value of a variable.
     void havoc(variable_t v) { m_inv -= v; }
 
+    /// Forget everything we know about a register.
+    void havoc(reg_pack_t reg) { m_inv.forget({reg.value, reg.offset, reg.type}); }
+
     void assign(variable_t lhs, variable_t rhs) { m_inv.assign(lhs, rhs); }
 
     /// Set a register to an integer with unknown value.
@@ -378,16 +769,51 @@ class ebpf_domain_t final {
     // a constraint, so all of them would be converted to some kind of
     // constraint that is added to the domain.
 
-    void operator()(const basic_block_t& bb, bool check_termination) {
+    static lowered_block_t lower(const basic_block_t& bb) {
+        lowered_block_t res;
+        res.size = bb.size();
+        lowering_t lowering{res.ops};
         for (const Instruction& statement : bb) {
-            std::visit(*this, statement);
+            std::visit(lowering, statement);
+        }
+        return res;
+    }
+
+    void operator()(const lowered_block_t& block, bool check_termination) {
+        for (const micro_op_t& op : block.ops) {
+            std::visit(*this, op);
         }
         if (check_termination) {
             // +1 to avoid being tricked by empty loops
-            add(variable_t::instruction_count(), z_number((unsigned)bb.size() + 1));
+            add(variable_t::instruction_count(), z_number((unsigned)block.size + 1));
+        }
+    }
+
+    void operator()(const basic_block_t& bb, bool check_termination) { (*this)(lower(bb), check_termination); }
+
+    void operator()(const micro::assign_const_t& op) { assign(op.x, op.k); }
+    void operator()(const micro::assign_var_t& op) { assign(op.x, op.y); }
+    void operator()(const micro::havoc_t& op) { havoc(op.x); }
+    void operator()(const micro::forget_t& op) { m_inv.forget(op.xs); }
+    void operator()(const micro::apply_const_t& op) { apply(m_inv, op.op, op.x, op.x, op.k, op.finite_width); }
+    void operator()(const micro::apply_var_t& op) { apply(m_inv, op.op, op.x, op.x, op.y, op.finite_width); }
+    void operator()(const micro::assume_t& op) { assume(op.cst); }
+    void operator()(const micro::assume_all_t& op) { m_inv += op.csts; }
+
+    void operator()(const micro::check_t& op) {
+        for (const linear_constraint_t& cst : op.csts) {
+            require(m_inv, cst, op.message);
         }
     }
 
+    void operator()(const micro::stack_load_t& op) {
+        if (m_inv.is_bottom())
+            return;
+        m_inv = do_load_stack(std::move(m_inv), op.target, op.addr, op.width);
+    }
+
+    void operator()(const micro::transfer_t& op) { std::visit(*this, op.ins); }
+
     bool terminates() {
         using namespace crab::dsl_syntax;
         constexpr int max_instructions = 100000;
@@ -408,8 +834,7 @@ class ebpf_domain_t final {
                     case T_UNINIT: break;
                     case T_NUM: {
                         if (!is_unsigned_cmp(cond.op))
-                            for (const linear_constraint_t& cst : jmp_to_cst_reg(cond.op, dst.value, src.value))
-                                m_inv += cst;
+                            m_inv += jmp_to_cst_reg(cond.op, dst.value, src.value);
                         return;
                     }
                     default: {
@@ -431,8 +856,7 @@ class ebpf_domain_t final {
             NumAbsDomain numbers{m_inv};
             numbers += dst.type == T_NUM;
             if (!is_unsigned_cmp(cond.op))
-                for (const linear_constraint_t& cst : jmp_to_cst_reg(cond.op, dst.value, src.value))
-                    numbers += cst;
+                numbers += jmp_to_cst_reg(cond.op, dst.value, src.value);
 
             m_inv += is_pointer(dst);
             m_inv += jmp_to_cst_offsets_reg(cond.op, dst.offset, src.offset);
@@ -443,8 +867,7 @@ class ebpf_domain_t final {
             m_inv |= std::move(null_dst);
         } else {
             int imm = static_cast<int>(std::get<Imm>(cond.right).v);
-            for (const linear_constraint_t& cst : jmp_to_cst_imm(cond.op, dst.value, imm))
-                assume(cst);
+            m_inv += jmp_to_cst_imm(cond.op, dst.value, imm);
         }
     }
 
@@ -517,7 +940,8 @@ class ebpf_domain_t final {
         require(m_inv, access_reg.type >= T_STACK, "Only stack or packet can be used as a parameter" + m);
         require(m_inv, access_reg.type <= T_PACKET, "Only stack or packet can be used as a parameter" + m);
 
-        if (!s.key) {
+        type_set_t types(m_inv[access_reg.type]);
+        if (!s.key && types.contains(T_STACK)) {
             auto when_stack = when(m_inv, access_reg.type == T_STACK);
             if (!when_stack.is_bottom()) {
                 if (!stack.all_num(when_stack, lb, ub)) {
@@ -526,8 +950,14 @@ class ebpf_domain_t final {
             }
         }
 
-        m_inv = check_access_packet(when(m_inv, access_reg.type == T_PACKET), lb, ub, m, false) |
-                check_access_stack(when(m_inv, access_reg.type == T_STACK), lb, ub, m);
+        m_inv = split_on_type(
+            std::move(m_inv),
+            {
+                {types.contains(T_PACKET), access_reg.type == T_PACKET,
+                 [&](NumAbsDomain inv) { return check_access_packet(std::move(inv), lb, ub, m, false); }},
+                {types.contains(T_STACK), access_reg.type == T_STACK,
+                 [&](NumAbsDomain inv) { return check_access_stack(std::move(inv), lb, ub, m); }},
+            });
     }
 
     void operator()(const ValidAccess& s) {
@@ -542,28 +972,32 @@ class ebpf_domain_t final {
             : lb + reg_pack(std::get<Reg>(s.width)).value;
         std::string m = std::string(" (") + to_string(s) + ")";
 
-        NumAbsDomain assume_ptr =
-            check_access_packet(when(m_inv, reg.type == T_PACKET), lb, ub, m, is_comparison_check) |
-            check_access_stack(when(m_inv, reg.type == T_STACK), lb, ub, m) |
-            check_access_shared(when(m_inv, is_shared(reg.type)), lb, ub, m, reg.type) |
-            check_access_context(when(m_inv, reg.type == T_CTX), lb, ub, m);
+        type_set_t types(m_inv[reg.type]);
+        const std::vector<type_case_t> cases{
+            {types.contains(T_PACKET), reg.type == T_PACKET,
+             [&](NumAbsDomain inv) { return check_access_packet(std::move(inv), lb, ub, m, is_comparison_check); }},
+            {types.contains(T_STACK), reg.type == T_STACK,
+             [&](NumAbsDomain inv) { return check_access_stack(std::move(inv), lb, ub, m); }},
+            {types.may_be_shared(), is_shared(reg.type),
+             [&](NumAbsDomain inv) { return check_access_shared(std::move(inv), lb, ub, m, reg.type); }},
+            {types.contains(T_CTX), reg.type == T_CTX,
+             [&](NumAbsDomain inv) { return check_access_context(std::move(inv), lb, ub, m); }},
+        };
+        if (!is_comparison_check && !s.or_null) {
+            // The state of non-pointers is dropped, so there is no need to keep a copy.
+            require(m_inv, reg.type > T_NUM, "Only pointers can be dereferenced");
+            m_inv = split_on_type(std::move(m_inv), cases);
+            return;
+        }
+        NumAbsDomain assume_ptr = split_on_type(m_inv, cases);
         if (is_comparison_check) {
             assume(m_inv, reg.type <= T_NUM);
-            m_inv |= std::move(assume_ptr);
-            return;
         } else {
-            if (s.or_null) {
-                require(m_inv, reg.type >= T_NUM, "Must be a pointer or null");
-                assume(m_inv, reg.type == T_NUM);
-                require(m_inv, reg.value == 0, "Pointers may be compared only to the number 0");
-                m_inv |= std::move(assume_ptr);
-                return;
-            } else {
-                require(m_inv, reg.type > T_NUM, "Only pointers can be dereferenced");
-                m_inv = std::move(assume_ptr);
-                return;
-            }
+            require(m_inv, reg.type >= T_NUM, "Must be a pointer or null");
+            assume(m_inv, reg.type == T_NUM);
+            require(m_inv, reg.value == 0, "Pointers may be compared only to the number 0");
         }
+        m_inv |= std::move(assume_ptr);
     }
 
     NumAbsDomain check_access_packet(NumAbsDomain inv, const linear_expression_t& lb, const linear_expression_t& ub, const std::string& s,
@@ -644,11 +1078,8 @@ class ebpf_domain_t final {
     void operator()(Assert const& stmt) { std::visit(*this, stmt.cst); };
 
     void operator()(Packet const& a) {
-        auto reg = reg_pack(R0_RETURN_VALUE);
-        assign(reg.type, T_NUM);
-        havoc(reg.offset);
-        havoc(reg.value);
         scratch_caller_saved_registers();
+        assign(reg_pack(R0_RETURN_VALUE).type, T_NUM);
     }
 
     static NumAbsDomain do_load_packet_or_shared(NumAbsDomain inv, reg_pack_t target, const linear_expression_t& addr, int width) {
@@ -707,8 +1138,7 @@ class ebpf_domain_t final {
             return inv;
         }
         inv.assign(target.type, T_PACKET);
-        inv += 4098 <= target.value;
-        inv += target.value <= PTR_MAX;
+        inv += {4098 <= target.value, target.value <= PTR_MAX};
         return inv;
     }
 
@@ -746,9 +1176,17 @@ class ebpf_domain_t final {
 
         switch (type) {
             case T_UNINIT: {
-                m_inv = do_load_ctx(when(m_inv, mem_reg.type == T_CTX), target, addr, width) |
-                        do_load_packet_or_shared(when(m_inv, mem_reg.type >= T_PACKET), target, addr, width) |
-                        do_load_stack(when(m_inv, mem_reg.type == T_STACK), target, addr, width);
+                type_set_t types(m_inv[mem_reg.type]);
+                m_inv = split_on_type(
+                    std::move(m_inv),
+                    {
+                        {types.contains(T_CTX), mem_reg.type == T_CTX,
+                         [&](NumAbsDomain inv) { return do_load_ctx(std::move(inv), target, addr, width); }},
+                        {types.contains(T_PACKET) || types.may_be_shared(), mem_reg.type >= T_PACKET,
+                         [&](NumAbsDomain inv) { return do_load_packet_or_shared(std::move(inv), target, addr, width); }},
+                        {types.contains(T_STACK), mem_reg.type == T_STACK,
+                         [&](NumAbsDomain inv) { return do_load_stack(std::move(inv), target, addr, width); }},
+                    });
                 return;
             }
             case T_MAP: return;
@@ -814,6 +1252,9 @@ class ebpf_domain_t final {
         switch (get_type(mem_reg.type)) {
             case T_STACK: do_store_stack(m_inv, width, addr, val_type, val_value, opt_val_offset); return;
             case T_UNINIT: { //maybe stack
+                if (!type_set_t(m_inv[mem_reg.type]).contains(T_STACK)) {
+                    break;
+                }
                 NumAbsDomain assume_not_stack(m_inv);
 #ifdef _MSC_VER
                 // MSVC seems to have a harder time coercing the right things, so force
@@ -880,18 +1321,15 @@ class ebpf_domain_t final {
         }
         scratch_caller_saved_registers();
         auto r0 = reg_pack(R0_RETURN_VALUE);
-        havoc(r0.value);
         if (call.returns_map) {
             // no support for map-in-map yet:
             //   if (machine.info.map_defs.at(map_type).type == MapType::ARRAY_OF_MAPS
             //    || machine.info.map_defs.at(map_type).type == MapType::HASH_OF_MAPS) { }
             // This is the only way to get a null pointer - note the `<=`:
-            m_inv += 0 <= r0.value;
-            m_inv += r0.value <= PTR_MAX;
+            m_inv += {0 <= r0.value, r0.value <= PTR_MAX};
             assign(r0.offset, 0);
             assign(r0.type, variable_t::map_value_size());
         } else {
-            havoc(r0.offset);
             assign(r0.type, T_NUM);
             // assume(r0.value < 0); for VOID, which is actually "no return if succeed".
         }
@@ -994,9 +1432,7 @@ class ebpf_domain_t final {
                     add_overflow(dst.value, src.value);
                     add(dst.offset, src.value);
                 } else {
-                    havoc(dst.type);
-                    havoc(dst.value);
-                    havoc(dst.offset);
+                    havoc(dst);
                 }
                 break;
             }
@@ -1013,9 +1449,7 @@ class ebpf_domain_t final {
                     havoc(dst.offset);
                     assign(dst.type, T_NUM);
                 } else {
-                    havoc(dst.type);
-                    havoc(dst.value);
-                    havoc(dst.offset);
+                    havoc(dst);
                 }
                 break;
             }
@@ -1088,16 +1522,13 @@ class ebpf_domain_t final {
         inv.assign(r10.type, T_STACK);
 
         auto r1 = reg_pack(R1_ARG);
-        inv += 1 <= r1.value;
-        inv += r1.value <= PTR_MAX;
+        inv += {1 <= r1.value, r1.value <= PTR_MAX};
         inv.assign(r1.offset, 0);
         inv.assign(r1.type, T_CTX);
 
-        inv += 0 <= variable_t::packet_size();
-        inv += variable_t::packet_size() < MAX_PACKET_OFF;
+        inv += {0 <= variable_t::packet_size(), variable_t::packet_size() < MAX_PACKET_OFF};
         if (global_program_info.type.context_descriptor.meta >= 0) {
-            inv += variable_t::meta_offset() <= 0;
-            inv += variable_t::meta_offset() >= -4098;
+            inv += {variable_t::meta_offset() <= 0, variable_t::meta_offset() >= -4098};
         } else {
             inv.assign(variable_t::meta_offset(), 0);
         }
@@ -1,10 +1,17 @@
 // Copyright (c) Prevail Verifier contributors.
 // SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "crab/cfg.hpp"
+#include "crab/liveness.hpp"
+#include "crab/thresholds.hpp"
 #include "crab/wto.hpp"
+#include "crab_utils/stats.hpp"
 
 #include "crab/ebpf_domain.hpp"
 #include "crab/fwd_analyzer.hpp"
@@ -50,15 +57,23 @@ class interleaved_fwd_fixpoint_iterator_t final {
     wto_t _wto;
     invariant_table_t _pre, _post;
 
-    /// number of iterations until triggering widening
-    const unsigned int _widening_delay{1};
+    /// Registers and stack bytes live after each block. Everything else is
+    /// forgotten from the postconditions, keeping joins and widenings small.
+    const liveness_table_t _live_out;
 
-    /// number of narrowing iterations. If the narrowing operator is
-    /// indeed a narrowing operator this parameter is not
-    /// needed. However, there are abstract domains for which an actual
-    /// narrowing operation is not available so we must enforce
-    /// termination.
-    const unsigned int _descending_iterations;
+    /// Each block lowered once, rather than in every iteration over it.
+    std::map<label_t, domains::lowered_block_t> _lowered;
+
+    /// maximum number of thresholds kept per loop
+    static constexpr size_t max_thresholds{64};
+
+    /// Constants each loop is likely to be bounded by, used to widen to
+    /// a finite bound before giving up and widening to infinity.
+    wto_thresholds_t _thresholds;
+
+    /// Widening delays and narrowing budget. The narrowing budget is
+    /// needed because not every narrowing operator enforces termination.
+    const fixpoint_strategy_t _strategy;
 
     /// Used to skip the analysis until _entry is found
     bool _skip{true};
@@ -71,18 +86,44 @@ class interleaved_fwd_fixpoint_iterator_t final {
     inline void set_pre(const label_t& label, const ebpf_domain_t& v) { _pre[label] = v; }
 
     inline void transform_to_post(const label_t& label, ebpf_domain_t pre) {
-        basic_block_t& bb = _cfg.get_node(label);
-        pre(bb, check_termination);
+        CrabStats::count("fixpoint.count.transform");
+        pre(_lowered.at(label), check_termination);
+        pre.forget_dead(_live_out.at(label));
         _post[label] = std::move(pre);
     }
 
+    static size_t count_nodes(const wto_cycle_t& cycle) {
+        size_t n = 1;
+        for (const wto_component_t& c : cycle) {
+            if (const auto* nested = std::get_if<wto_cycle_t>(&c)) {
+                n += count_nodes(*nested);
+            } else {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    /// number of iterations until triggering widening on this visit of cycle
+    unsigned int widening_delay(wto_cycle_t& cycle) {
+        const std::vector<unsigned int>& delays = _strategy.widening_delay;
+        wto_nesting_t nesting = _wto.nesting(cycle.head());
+        size_t depth = std::distance(nesting.begin(), nesting.end());
+        unsigned int delay = delays.empty() ? 0 : delays[std::min(depth, delays.size() - 1)];
+        if (_strategy.small_loop_unrolling > 0 && cycle.fixpo_visits() < _strategy.max_unrolled_visits &&
+            count_nodes(cycle) <= _strategy.small_loop_size) {
+            delay += _strategy.small_loop_unrolling;
+        }
+        return delay;
+    }
+
     [[nodiscard]]
-    ebpf_domain_t extrapolate(const label_t& node, unsigned int iteration, ebpf_domain_t before,
-                              const ebpf_domain_t& after) const {
-        if (iteration <= _widening_delay) {
+    ebpf_domain_t extrapolate(const label_t& node, unsigned int iteration, unsigned int widening_delay,
+                              ebpf_domain_t before, const ebpf_domain_t& after) const {
+        if (iteration <= widening_delay) {
             return before | after;
         } else {
-            return before.widen(after);
+            return before.widening_thresholds(after, _thresholds.get_thresholds(node));
         }
     }
 
@@ -104,11 +145,16 @@ class interleaved_fwd_fixpoint_iterator_t final {
     }
 
   public:
-    explicit interleaved_fwd_fixpoint_iterator_t(cfg_t& cfg, unsigned int descending_iterations, bool check_termination)
-        : _cfg(cfg), _wto(cfg), _descending_iterations(descending_iterations), check_termination(check_termination) {
+    explicit interleaved_fwd_fixpoint_iterator_t(cfg_t& cfg, const fixpoint_strategy_t& strategy, bool check_termination)
+        : _cfg(cfg), _wto(cfg), _live_out(compute_live_out(cfg)), _thresholds(cfg, max_thresholds),
+          _strategy(strategy), check_termination(check_termination) {
+        for (wto_component_t& c : _wto) {
+            std::visit(_thresholds, c);
+        }
         for (const auto& label : _cfg.labels()) {
             _pre.emplace(label, ebpf_domain_t::bottom());
             _post.emplace(label, ebpf_domain_t::bottom());
+            _lowered.emplace(label, ebpf_domain_t::lower(_cfg.get_node(label)));
         }
         _pre[this->_cfg.entry_label()] = ebpf_domain_t::setup_entry(check_termination);
     }
@@ -121,13 +167,13 @@ class interleaved_fwd_fixpoint_iterator_t final {
 
     void operator()(wto_cycle_t& cycle);
 
-    friend std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg, bool check_termination);
+    friend std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg,
+                                                                                const ebpf_verifier_options_t& options);
 };
 
-std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg, bool check_termination) {
+std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg, const ebpf_verifier_options_t& options) {
     // Go over the CFG in weak topological order (accounting for loops).
-    constexpr unsigned int descending_iterations = 2000000;
-    interleaved_fwd_fixpoint_iterator_t analyzer(cfg, descending_iterations, check_termination);
+    interleaved_fwd_fixpoint_iterator_t analyzer(cfg, options.fixpoint, options.check_termination);
     for (wto_component_t& c : analyzer._wto) {
         std::visit(analyzer, c);
     }
@@ -180,6 +226,7 @@ void interleaved_fwd_fixpoint_iterator_t::operator()(wto_cycle_t& cycle) {
         }
     }
 
+    unsigned int delay = widening_delay(cycle);
     for (unsigned int iteration = 1;; ++iteration) {
         // keep track of how many times the cycle is visited by the fixpoint
         cycle.increment_fixpo_visits();
@@ -197,11 +244,11 @@ void interleaved_fwd_fixpoint_iterator_t::operator()(wto_cycle_t& cycle) {
             pre = std::move(new_pre);
             break;
         } else {
-            pre = extrapolate(head, iteration, pre, new_pre);
+            pre = extrapolate(head, iteration, delay, pre, new_pre);
         }
     }
 
-    if (this->_descending_iterations == 0) {
+    if (!_strategy.narrowing || _strategy.narrowing_iterations == 0) {
         // no narrowing
         return;
     }
@@ -218,7 +265,7 @@ void interleaved_fwd_fixpoint_iterator_t::operator()(wto_cycle_t& cycle) {
             // No more refinement possible(pre == new_pre)
             break;
         } else {
-            if (iteration > _descending_iterations)
+            if (iteration > _strategy.narrowing_iterations)
                 break;
             pre = refine(head, iteration, pre, new_pre);
             set_pre(head, pre);
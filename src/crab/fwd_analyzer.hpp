@@ -14,6 +14,6 @@ namespace crab {
 using domains::ebpf_domain_t;
 using invariant_table_t = std::map<label_t, ebpf_domain_t>;
 
-std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg, bool check_termination);
+std::pair<invariant_table_t, invariant_table_t> run_forward_analyzer(cfg_t& cfg, const ebpf_verifier_options_t& options);
 
 } // namespace crab
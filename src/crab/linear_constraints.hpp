@@ -42,11 +42,12 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
 #include <optional>
 #include <utility>
 #include <vector>
 
+#include <boost/container/small_vector.hpp>
 #include <boost/functional/hash.hpp>
 
 #include "crab/variable.hpp"
@@ -56,32 +57,62 @@ namespace crab {
 
 class linear_expression_t final {
   private:
-    using map_t = std::map<variable_t, number_t>;
+    // Terms are kept sorted by variable with at most one entry per
+    // variable. Almost all expressions built by the transfer functions
+    // have one or two terms, so they fit in the inline buffer.
+    using term_t = std::pair<variable_t, number_t>;
+    using terms_t = boost::container::small_vector<term_t, 4>;
 
-    map_t _map;
+    terms_t _terms;
     number_t _cst = 0;
 
-    linear_expression_t(map_t map, number_t cst) : _map(std::move(map)), _cst(std::move(cst)) {}
+    linear_expression_t(terms_t terms, number_t cst) : _terms(std::move(terms)), _cst(std::move(cst)) {}
 
-    static void add(map_t& map, variable_t x, const number_t& n) {
-        auto it = map.find(x);
-        if (it != map.end()) {
+    static bool term_lt(const term_t& t, variable_t x) { return t.first < x; }
+
+    static void add(terms_t& terms, variable_t x, const number_t& n) {
+        auto it = std::lower_bound(terms.begin(), terms.end(), x, term_lt);
+        if (it != terms.end() && it->first == x) {
             number_t r = it->second + n;
             if (r == 0) {
-                map.erase(it);
+                terms.erase(it);
             } else {
                 it->second = r;
             }
         } else {
             if (n != 0) {
-                map.emplace(x, n);
+                terms.emplace(it, x, n);
             }
         }
     }
 
+    // Merge two sorted term lists, computing a + b (or a - b).
+    static terms_t merge(const terms_t& a, const terms_t& b, bool subtract) {
+        terms_t res;
+        res.reserve(a.size() + b.size());
+        auto ia = a.begin(), ea = a.end();
+        auto ib = b.begin(), eb = b.end();
+        while (ia != ea || ib != eb) {
+            if (ib == eb || (ia != ea && ia->first < ib->first)) {
+                res.push_back(*ia++);
+            } else {
+                number_t n = subtract ? -ib->second : ib->second;
+                if (ia != ea && ia->first == ib->first) {
+                    n = ia->second + n;
+                    ++ia;
+                }
+                if (n != 0) {
+                    res.emplace_back(ib->first, std::move(n));
+                }
+                ++ib;
+            }
+        }
+        return res;
+    }
+
   public:
-    using iterator = typename map_t::iterator;
-    using const_iterator = typename map_t::const_iterator;
+    using iterator = typename terms_t::iterator;
+    using const_iterator = typename terms_t::const_iterator;
 
     linear_expression_t() = default;
 
@@ -92,15 +123,13 @@ class linear_expression_t final {
 
     linear_expression_t(signed long long int n) : _cst(number_t(n)) {}
 
-    linear_expression_t(variable_t x) : _map{ {x, number_t(1)} } {
-    }
+    linear_expression_t(variable_t x) { _terms.emplace_back(x, number_t(1)); }
 
-    linear_expression_t(const number_t& n, variable_t x) : _map{ {x, n} } {
-    }
+    linear_expression_t(const number_t& n, variable_t x) { _terms.emplace_back(x, n); }
 
-    [[nodiscard]] const_iterator begin() const { return this->_map.begin(); }
+    [[nodiscard]] const_iterator begin() const { return this->_terms.begin(); }
 
-    [[nodiscard]] const_iterator end() const { return this->_map.end(); }
+    [[nodiscard]] const_iterator end() const { return this->_terms.end(); }
 
     [[nodiscard]] size_t hash() const {
         size_t res = 0;
@@ -111,14 +140,14 @@ class linear_expression_t final {
         return res;
     }
 
-    [[nodiscard]] bool is_constant() const { return this->_map.empty(); }
+    [[nodiscard]] bool is_constant() const { return this->_terms.empty(); }
 
     [[nodiscard]] number_t constant() const { return this->_cst; }
 
-    [[nodiscard]] std::size_t size() const { return this->_map.size(); }
+    [[nodiscard]] std::size_t size() const { return this->_terms.size(); }
 
     linear_expression_t operator+(const number_t& n) const {
-        return linear_expression_t(this->_map, this->_cst + n);
+        return linear_expression_t(this->_terms, this->_cst + n);
     }
 
     linear_expression_t operator+(int n) const { return this->operator+(number_t(n)); }
@@ -127,17 +156,13 @@ class linear_expression_t final {
 #endif
 
     linear_expression_t operator+(variable_t x) const {
-        map_t map = this->_map;
-        add(map, x, number_t(1));
-        return linear_expression_t(map, this->_cst);
+        terms_t terms = this->_terms;
+        add(terms, x, number_t(1));
+        return linear_expression_t(std::move(terms), this->_cst);
     }
 
     linear_expression_t operator+(const linear_expression_t& e) const {
-        map_t map = this->_map;
-        for (const auto& [k, v] : e._map) {
-            add(map, k, v);
-        }
-        return linear_expression_t(map, this->_cst + e._cst);
+        return linear_expression_t(merge(this->_terms, e._terms, false), this->_cst + e._cst);
     }
 
     linear_expression_t operator-(const number_t& n) const { return this->operator+(-n); }
@@ -145,33 +170,30 @@ class linear_expression_t final {
     linear_expression_t operator-(int n) const { return this->operator+(-number_t(n)); }
 
     linear_expression_t operator-(variable_t x) const {
-        map_t map = this->_map;
-        add(map, x, number_t(-1));
-        return linear_expression_t(map, this->_cst);
+        terms_t terms = this->_terms;
+        add(terms, x, number_t(-1));
+        return linear_expression_t(std::move(terms), this->_cst);
     }
 
     linear_expression_t operator-() const { return this->operator*(number_t(-1)); }
 
     linear_expression_t operator-(const linear_expression_t& e) const {
-        map_t map = this->_map;
-        for (const auto& [k ,v] : e._map) {
-            add(map, k, -v);
-        }
-        return linear_expression_t(map, this->_cst - e._cst);
+        return linear_expression_t(merge(this->_terms, e._terms, true), this->_cst - e._cst);
     }
 
     linear_expression_t operator*(const number_t& n) const {
         if (n == 0) {
             return linear_expression_t();
         } else {
-            map_t map;
-            for (const auto& [k, v] : _map) {
+            terms_t terms;
+            terms.reserve(_terms.size());
+            for (const auto& [k, v] : _terms) {
                 number_t c = n * v;
                 if (c != 0) {
-                    map.emplace(k, c);
+                    terms.emplace_back(k, std::move(c));
                 }
             }
-            return linear_expression_t(map, n * this->_cst);
+            return linear_expression_t(std::move(terms), n * this->_cst);
         }
     }
 
@@ -191,10 +213,10 @@ class linear_expression_t final {
             o << v;
             start = false;
         }
-        if (e._cst > 0 && !e._map.empty()) {
+        if (e._cst > 0 && !e._terms.empty()) {
             o << "+";
         }
-        if (e._cst != 0 || e._map.empty()) {
+        if (e._cst != 0 || e._terms.empty()) {
             o << e._cst;
         }
         return o;
@@ -0,0 +1,210 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <set>
+#include <variant>
+#include <vector>
+
+#include "crab/liveness.hpp"
+
+namespace crab {
+
+/// Backward transfer of a single instruction: live := (live - def) | use.
+/// Every read through a pointer that is not r10 may hit any stack byte.
+class live_vars_transformer_t final {
+    live_vars_t& live;
+
+    void use(Reg r) { live.regs.set(r.v); }
+
+    void use(const Value& v) {
+        if (const Reg* r = std::get_if<Reg>(&v)) {
+            use(*r);
+        }
+    }
+
+    void def(Reg r) { live.regs.reset(r.v); }
+
+    void scratch_caller_saved_registers() {
+        for (uint8_t i = R0_RETURN_VALUE; i <= R5_ARG; i++) {
+            def(Reg{i});
+        }
+    }
+
+    // Apply f to each stack byte accessed by [basereg + offset, basereg + offset + width),
+    // or return false if basereg may point to any of them.
+    template <typename F>
+    static bool for_each_stack_byte(const Deref& access, F f) {
+        if (access.basereg.v != R10_STACK_POINTER) {
+            return false;
+        }
+        for (int i = EBPF_STACK_SIZE + access.offset; i < EBPF_STACK_SIZE + access.offset + access.width; i++) {
+            if (i >= 0 && i < EBPF_STACK_SIZE) {
+                f(i);
+            }
+        }
+        return true;
+    }
+
+    void read(const Deref& access) {
+        if (!for_each_stack_byte(access, [&](int i) { live.stack.set(i); })) {
+            live.stack.set();
+        }
+    }
+
+    void write(const Deref& access) {
+        for_each_stack_byte(access, [&](int i) { live.stack.reset(i); });
+    }
+
+  public:
+    explicit live_vars_transformer_t(live_vars_t& live) : live(live) {}
+
+    void operator()(const Undefined&) {}
+
+    void operator()(const Bin& bin) {
+        def(bin.dst);
+        if (bin.op != Bin::Op::MOV) {
+            use(bin.dst);
+        }
+        use(bin.v);
+    }
+
+    void operator()(const Un& un) { use(un.dst); }
+
+    void operator()(const LoadMapFd& ins) { def(ins.dst); }
+
+    void operator()(const Call& call) {
+        scratch_caller_saved_registers();
+        bool reads_memory = false;
+        for (const ArgSingle& param : call.singles) {
+            use(param.reg);
+            reads_memory |= param.kind == ArgSingle::Kind::PTR_TO_MAP_KEY ||
+                            param.kind == ArgSingle::Kind::PTR_TO_MAP_VALUE;
+        }
+        for (const ArgPair& param : call.pairs) {
+            use(param.mem);
+            use(param.size);
+            reads_memory |= param.kind != ArgPair::Kind::PTR_TO_UNINIT_MEM;
+        }
+        if (reads_memory) {
+            live.stack.set();
+        }
+    }
+
+    void operator()(const Exit&) {
+        live = {};
+        use(Reg{R0_RETURN_VALUE});
+    }
+
+    void operator()(const Jmp& jmp) {
+        if (jmp.cond) {
+            use(jmp.cond->left);
+            use(jmp.cond->right);
+        }
+    }
+
+    void operator()(const Assume& assume) {
+        use(assume.cond.left);
+        use(assume.cond.right);
+    }
+
+    void operator()(const Packet& packet) {
+        scratch_caller_saved_registers();
+        // The packet is implicitly accessed through the context in r6.
+        use(Reg{R6});
+        if (packet.regoffset) {
+            use(*packet.regoffset);
+        }
+    }
+
+    void operator()(const Mem& mem) {
+        if (mem.is_load) {
+            def(std::get<Reg>(mem.value));
+            read(mem.access);
+        } else {
+            write(mem.access);
+            use(mem.value);
+        }
+        use(mem.access.basereg);
+    }
+
+    void operator()(const LockAdd& lock) {
+        read(lock.access);
+        use(lock.access.basereg);
+        use(lock.valreg);
+    }
+
+    void operator()(const Assert& a) { std::visit(*this, a.cst); }
+
+    void operator()(const Comparable& s) {
+        use(s.r1);
+        use(s.r2);
+    }
+
+    void operator()(const Addable& s) {
+        use(s.ptr);
+        use(s.num);
+    }
+
+    void operator()(const ValidAccess& s) {
+        use(s.reg);
+        use(s.width);
+    }
+
+    void operator()(const ValidStore& s) {
+        use(s.mem);
+        use(s.val);
+    }
+
+    void operator()(const ValidSize& s) { use(s.reg); }
+
+    void operator()(const ValidMapKeyValue& s) {
+        use(s.access_reg);
+        use(s.map_fd_reg);
+        live.stack.set();
+    }
+
+    void operator()(const TypeConstraint& s) { use(s.reg); }
+};
+
+static live_vars_t live_in(const basic_block_t& bb, live_vars_t live) {
+    live_vars_transformer_t transformer(live);
+    for (auto it = bb.rbegin(); it != bb.rend(); ++it) {
+        std::visit(transformer, *it);
+    }
+    return live;
+}
+
+liveness_table_t compute_live_out(const cfg_t& cfg) {
+    liveness_table_t live_out;
+    std::map<label_t, live_vars_t> live_ins;
+    std::vector<label_t> labels = cfg.labels();
+    for (const label_t& label : labels) {
+        live_out[label] = {};
+        live_ins[label] = {};
+    }
+
+    std::set<label_t> worklist(labels.begin(), labels.end());
+    while (!worklist.empty()) {
+        // Labels mostly follow program order, so going backwards converges quickly.
+        auto last = std::prev(worklist.end());
+        label_t label = *last;
+        worklist.erase(last);
+
+        live_vars_t out;
+        out.regs.set(R10_STACK_POINTER);
+        for (const label_t& next : cfg.next_nodes(label)) {
+            out |= live_ins.at(next);
+        }
+        live_out[label] = out;
+
+        live_vars_t in = live_in(cfg.get_node(label), out);
+        if (in != live_ins.at(label)) {
+            live_ins[label] = in;
+            for (const label_t& prev : cfg.prev_nodes(label)) {
+                worklist.insert(prev);
+            }
+        }
+    }
+    return live_out;
+}
+
+} // namespace crab
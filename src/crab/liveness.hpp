@@ -0,0 +1,38 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+// This file is eBPF-specific, not derived from CRAB.
+
+#include <bitset>
+#include <map>
+
+#include "crab/cfg.hpp"
+#include "ebpf_vm_isa.hpp"
+#include "spec_type_descriptors.hpp"
+
+namespace crab {
+
+/// Registers and stack bytes whose current contents may still be read.
+/// Stack byte i is the byte at r10 - EBPF_STACK_SIZE + i.
+struct live_vars_t {
+    std::bitset<R10_STACK_POINTER + 1> regs;
+    std::bitset<EBPF_STACK_SIZE> stack;
+
+    bool operator==(const live_vars_t& o) const { return regs == o.regs && stack == o.stack; }
+    bool operator!=(const live_vars_t& o) const { return !(*this == o); }
+
+    live_vars_t& operator|=(const live_vars_t& o) {
+        regs |= o.regs;
+        stack |= o.stack;
+        return *this;
+    }
+};
+
+using liveness_table_t = std::map<label_t, live_vars_t>;
+
+/// Backward may-liveness analysis. Return the variables live on exit from
+/// each basic block. r10 is always live.
+liveness_table_t compute_live_out(const cfg_t& cfg);
+
+} // namespace crab
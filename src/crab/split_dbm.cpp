@@ -10,12 +10,11 @@
 namespace crab::domains {
 
 SplitDBM::vert_id SplitDBM::get_vert(variable_t v) {
-    auto it = vert_map.find(v);
-    if (it != vert_map.end())
-        return (*it).second;
+    if (auto vert = vert_map.find(v))
+        return *vert;
 
     vert_id vert(g.new_vertex());
-    vert_map.insert(vmap_elt_t(v, vert));
+    vert_map.insert(v, vert);
     // Initialize
     assert(vert <= rev_map.size());
     if (vert < rev_map.size()) {
@@ -25,7 +24,6 @@ SplitDBM::vert_id SplitDBM::get_vert(variable_t v) {
         potential.emplace_back(0);
         rev_map.push_back(v);
     }
-    vert_map.insert(vmap_elt_t(v, vert));
 
     assert(vert != 0);
 
@@ -159,13 +157,55 @@ void SplitDBM::diffcsts_of_assign(variable_t x, const linear_expression_t& exp,
     }
 }
 
+bool SplitDBM::diffcsts_of_unit_lin_leq(const linear_expression_t& exp, const Wt& exp_ub, diffcst_vector_t& csts,
+                                        bound_vector_t& lbs, bound_vector_t& ubs) {
+    // Fast path for x - y + k <= 0, which is what almost every constraint
+    // over registers and stack cells looks like. This yields the same
+    // constraints as the general case in diffcsts_of_lin_leq:
+    // x - y <= -k, plus y >= lb(x) + k and x <= ub(y) - k.
+    if (exp.size() != 2) {
+        return false;
+    }
+    const auto& [v1, n1] = *exp.begin();
+    const auto& [v2, n2] = *std::next(exp.begin());
+    if (!((n1 == 1 && n2 == -1) || (n1 == -1 && n2 == 1))) {
+        return false;
+    }
+    variable_t x = (n1 == 1) ? v1 : v2;
+    variable_t y = (n1 == 1) ? v2 : v1;
+
+    bool overflow;
+    std::optional<Wt> xmin, ymax;
+    if (auto x_lb = operator[](x).lb(); !x_lb.is_infinite()) {
+        xmin = convert_NtoW(*x_lb.number(), overflow);
+        if (overflow) {
+            return false;
+        }
+    }
+    if (auto y_ub = operator[](y).ub(); !y_ub.is_infinite()) {
+        ymax = convert_NtoW(*y_ub.number(), overflow);
+        if (overflow) {
+            return false;
+        }
+    }
+
+    csts.push_back({{x, y}, exp_ub});
+    if (xmin) {
+        lbs.emplace_back(y, *xmin - exp_ub);
+    }
+    if (ymax) {
+        ubs.emplace_back(x, *ymax + exp_ub);
+    }
+    return true;
+}
+
 void SplitDBM::diffcsts_of_lin_leq(const linear_expression_t& exp,
                                    /* difference contraints */
-                                   std::vector<diffcst_t>& csts,
+                                   diffcst_vector_t& csts,
                                    /* x >= lb for each {x,lb} in lbs */
-                                   std::vector<std::pair<variable_t, Wt>>& lbs,
+                                   bound_vector_t& lbs,
                                    /* x <= ub for each {x,ub} in ubs */
-                                   std::vector<std::pair<variable_t, Wt>>& ubs) {
+                                   bound_vector_t& ubs) {
     bool underflow, overflow;
 
     Wt exp_ub = -(convert_NtoW(exp.constant(), overflow));
@@ -181,6 +221,10 @@ void SplitDBM::diffcsts_of_lin_leq(const linear_expression_t& exp,
         return;
     }
 
+    if (diffcsts_of_unit_lin_leq(exp, exp_ub, csts, lbs, ubs)) {
+        return;
+    }
+
     Wt unbounded_lbcoeff;
     Wt unbounded_ubcoeff;
     std::optional<variable_t> unbounded_lbvar;
@@ -270,9 +314,9 @@ void SplitDBM::diffcsts_of_lin_leq(const linear_expression_t& exp,
     }
 }
 
-bool SplitDBM::add_linear_leq(const linear_expression_t& exp) {
-    std::vector<std::pair<variable_t, Wt>> lbs, ubs;
-    std::vector<diffcst_t> csts;
+bool SplitDBM::add_linear_leq(const linear_expression_t& exp, bool close) {
+    bound_vector_t lbs, ubs;
+    diffcst_vector_t csts;
     diffcsts_of_lin_leq(exp, csts, lbs, ubs);
 
     typename graph_t::mut_val_ref_t w;
@@ -315,11 +359,17 @@ bool SplitDBM::add_linear_leq(const linear_expression_t& exp) {
     // Collect bounds
     // GKG: Now done in close_over_edge
 
+    if (close) {
+        close_bounds();
+    }
+    // CRAB_WARN("SplitDBM::add_linear_leq not yet implemented.");
+    return true;
+}
+
+void SplitDBM::close_bounds() {
     edge_vector delta;
     GrOps::close_after_assign(g, potential, 0, delta);
     GrOps::apply_delta(g, delta);
-    // CRAB_WARN("SplitDBM::add_linear_leq not yet implemented.");
-    return true;
 }
 
 void SplitDBM::add_univar_disequation(variable_t x, const number_t& n) {
@@ -384,12 +434,12 @@ void SplitDBM::add_univar_disequation(variable_t x, const number_t& n) {
     }
 }
 
-bool SplitDBM::operator<=(SplitDBM o) {
+bool SplitDBM::operator<=(const SplitDBM& o) {
     CrabStats::count("SplitDBM.count.leq");
     ScopedCrabStats __st__("SplitDBM.leq");
 
     // cover all trivial cases to avoid allocating a dbm matrix
-    if (is_bottom())
+    if (is_bottom() || this == &o)
         return true;
     else if (o.is_bottom())
         return false;
@@ -398,6 +448,8 @@ bool SplitDBM::operator<=(SplitDBM o) {
     else if (is_top())
         return false;
     else {
+        // Only this side needs to be closed: every edge of o is checked
+        // against the tightest bound this implies.
         normalize();
 
         // CRAB_LOG("zones-split", std::cout << "operator<=: "<< *this<< "<=?"<< o <<"\n");
@@ -405,30 +457,31 @@ bool SplitDBM::operator<=(SplitDBM o) {
         if (vert_map.size() < o.vert_map.size())
             return false;
 
-        typename graph_t::mut_val_ref_t wx;
-        typename graph_t::mut_val_ref_t wy;
-
         // Set up a mapping from o to this.
         std::vector<unsigned int> vert_renaming(o.g.size(), -1);
         vert_renaming[0] = 0;
-        for (auto [v, n] : o.vert_map) {
-            if (o.g.succs(n).size() == 0 && o.g.preds(n).size() == 0)
-                continue;
+        bool missing = false;
+        o.vert_map.for_each([&](vert_id n) {
+            if (missing || (o.g.e_succs(n).size() == 0 && o.g.e_preds(n).size() == 0))
+                return;
 
-            auto it = vert_map.find(v);
+            std::optional<vert_id> vert = vert_map.find(*o.rev_map[n]);
             // We can't have this <= o if we're missing some
             // vertex.
-            if (it == vert_map.end())
-                return false;
-            vert_renaming[n] = it->second;
-            // vert_renaming[(*it).second] = p.second;
-        }
+            if (!vert) {
+                missing = true;
+                return;
+            }
+            vert_renaming[n] = *vert;
+        });
+        if (missing)
+            return false;
 
         assert(g.size() > 0);
         // GrPerm g_perm(vert_renaming, g);
 
         for (vert_id ox : o.g.verts()) {
-            if (o.g.succs(ox).size() == 0)
+            if (o.g.e_succs(ox).size() == 0)
                 continue;
 
             assert(vert_renaming[ox] != (unsigned)-1);
@@ -439,12 +492,12 @@ bool SplitDBM::operator<=(SplitDBM o) {
                 vert_id y = vert_renaming[oy];
                 Wt ow = edge.val;
 
-                if (g.lookup(x, y, &wx) && (wx.get() <= ow))
+                if (std::optional<Wt> wxy = g.lookup(x, y); wxy && *wxy <= ow)
                     continue;
 
-                if (!g.lookup(x, 0, &wx) || !g.lookup(0, y, &wy))
-                    return false;
-                if (!(wx.get() + wy.get() <= ow))
+                std::optional<Wt> wx = g.lookup(x, 0);
+                std::optional<Wt> wy = g.lookup(0, y);
+                if (!wx || !wy || !(*wx + *wy <= ow))
                     return false;
             }
         }
@@ -488,22 +541,22 @@ SplitDBM SplitDBM::operator|(const SplitDBM& _o) & {
     perm_y.push_back(0);
     out_revmap.push_back(std::nullopt);
 
-    for (auto [v, n] : vert_map) {
-        auto it = o.vert_map.find(v);
+    vert_map.for_each([&](vert_id n) {
+        variable_t v = *rev_map[n];
         // Variable exists in both
-        if (it != o.vert_map.end()) {
-            out_vmap.insert(vmap_elt_t(v, static_cast<vert_id>(perm_x.size())));
+        if (std::optional<vert_id> m = o.vert_map.find(v)) {
+            out_vmap.insert(v, static_cast<vert_id>(perm_x.size()));
             out_revmap.push_back(v);
 
             pot_rx.push_back(potential[n] - potential[0]);
             // XXX JNL: check this out
             // pot_ry.push_back(o.potential[p.second] - o.potential[0]);
-            pot_ry.push_back(o.potential[it->second] - o.potential[0]);
+            pot_ry.push_back(o.potential[*m] - o.potential[0]);
             perm_inv.push_back(v);
             perm_x.push_back(n);
-            perm_y.push_back(it->second);
+            perm_y.push_back(*m);
         }
-    }
+    });
     size_t sz = perm_x.size();
 
     // Build the permuted view of x and y.
@@ -626,6 +679,7 @@ SplitDBM SplitDBM::operator|(const SplitDBM& _o) & {
 
     // SplitDBM res(join_range, out_vmap, out_revmap, join_g, join_pot);
     SplitDBM res(std::move(out_vmap), std::move(out_revmap), std::move(join_g), std::move(pot_rx), vert_set_t());
+    CrabStats::count_max("SplitDBM.max.join_edges", static_cast<unsigned>(res.g.num_edges()));
     // join_g.check_adjs();
     CRAB_LOG("zones-split", std::cout << "Result join:\n" << res << "\n");
 
@@ -661,18 +715,18 @@ SplitDBM SplitDBM::widen(SplitDBM o) {
         perm_x.push_back(0);
         perm_y.push_back(0);
         out_revmap.push_back(std::nullopt);
-        for (auto [v, n] : vert_map) {
-            auto it = o.vert_map.find(v);
+        vert_map.for_each([&](vert_id n) {
+            variable_t v = *rev_map[n];
             // Variable exists in both
-            if (it != o.vert_map.end()) {
-                out_vmap.insert(vmap_elt_t(v, static_cast<vert_id>(perm_x.size())));
+            if (std::optional<vert_id> m = o.vert_map.find(v)) {
+                out_vmap.insert(v, static_cast<vert_id>(perm_x.size()));
                 out_revmap.push_back(v);
 
                 widen_pot.push_back(potential[n] - potential[0]);
                 perm_x.push_back(n);
-                perm_y.push_back(it->second);
+                perm_y.push_back(*m);
             }
-        }
+        });
 
         // Build the permuted view of x and y.
         assert(g.size() > 0);
@@ -693,6 +747,35 @@ SplitDBM SplitDBM::widen(SplitDBM o) {
         return res;
     }
 }
+SplitDBM SplitDBM::widening_thresholds(SplitDBM o, const iterators::thresholds_t& ts) {
+    if (is_bottom() || o.is_bottom())
+        return widen(std::move(o));
+
+    // Plain widening drops every unary bound that grew. Remember the next
+    // threshold past each grown bound, so that it can be put back.
+    std::vector<linear_constraint_t> csts;
+    vert_map.for_each([&](vert_id v) {
+        variable_t x = *rev_map[v];
+        interval_t before = (*this)[x];
+        interval_t after = o[x];
+        if (before.ub() < after.ub()) {
+            bound_t ub = ts.get_next(after.ub());
+            if (std::optional<number_t> n = ub.number())
+                csts.emplace_back(linear_expression_t(x) - *n, cst_kind::INEQUALITY);
+        }
+        if (after.lb() < before.lb()) {
+            bound_t lb = ts.get_prev(after.lb());
+            if (std::optional<number_t> n = lb.number())
+                csts.emplace_back(-linear_expression_t(x) + *n, cst_kind::INEQUALITY);
+        }
+    });
+
+    SplitDBM res = widen(std::move(o));
+    for (const linear_constraint_t& cst : csts)
+        res += cst;
+    return res;
+}
+
 SplitDBM SplitDBM::operator&(SplitDBM o) {
     CrabStats::count("SplitDBM.count.meet");
     ScopedCrabStats __st__("SplitDBM.meet");
@@ -724,32 +807,32 @@ SplitDBM SplitDBM::operator&(SplitDBM o) {
         perm_y.push_back(0);
         meet_pi.emplace_back(0);
         meet_rev.push_back(std::nullopt);
-        for (auto [v, n] : vert_map) {
+        vert_map.for_each([&](vert_id n) {
+            variable_t v = *rev_map[n];
             vert_id vv = static_cast<vert_id>(perm_x.size());
-            meet_verts.insert(vmap_elt_t(v, vv));
+            meet_verts.insert(v, vv);
             meet_rev.push_back(v);
 
             perm_x.push_back(n);
             perm_y.push_back(-1);
             meet_pi.push_back(potential[n] - potential[0]);
-        }
+        });
 
         // Add missing mappings from the right operand.
-        for (auto [v, n] : o.vert_map) {
-            auto it = meet_verts.find(v);
-
-            if (it == meet_verts.end()) {
-                vert_id vv = static_cast<vert_id>(perm_y.size());
+        o.vert_map.for_each([&](vert_id n) {
+            variable_t v = *o.rev_map[n];
+            if (std::optional<vert_id> vv = meet_verts.find(v)) {
+                perm_y[*vv] = n;
+            } else {
+                vert_id nv = static_cast<vert_id>(perm_y.size());
                 meet_rev.push_back(v);
 
                 perm_y.push_back(n);
                 perm_x.push_back(-1);
                 meet_pi.push_back(o.potential[n] - o.potential[0]);
-                meet_verts.insert(vmap_elt_t(v, vv));
-            } else {
-                perm_y[it->second] = n;
+                meet_verts.insert(v, nv);
             }
-        }
+        });
 
         // Build the permuted view of x and y.
         assert(g.size() > 0);
@@ -795,10 +878,9 @@ void SplitDBM::operator-=(variable_t v) {
         return;
     normalize();
 
-    auto it = vert_map.find(v);
-    if (it != vert_map.end()) {
-        g.forget(it->second);
-        rev_map[it->second] = std::nullopt;
+    if (auto vert = vert_map.find(v)) {
+        g.forget(*vert);
+        rev_map[*vert] = std::nullopt;
         vert_map.erase(v);
     }
 }
@@ -810,7 +892,76 @@ void SplitDBM::operator+=(const linear_constraint_t& cst) {
     if (is_bottom())
         return;
     normalize();
+    add_constraint(cst);
+}
+
+bool SplitDBM::is_deferrable(const linear_constraint_t& cst) {
+    if (!cst.is_inequality() && !cst.is_strict_inequality() && !cst.is_equality())
+        return false;
+    const linear_expression_t& exp = cst.expression();
+    auto it = exp.begin();
+    switch (exp.size()) {
+    case 1: return it->second == 1 || it->second == -1;
+    case 2: {
+        const number_t& n1 = it->second;
+        const number_t& n2 = (++it)->second;
+        return (n1 == 1 && n2 == -1) || (n1 == -1 && n2 == 1);
+    }
+    default: return false;
+    }
+}
+
+void SplitDBM::operator+=(const std::vector<linear_constraint_t>& csts) {
+    CrabStats::count("SplitDBM.count.add_constraints");
+    ScopedCrabStats __st__("SplitDBM.add_constraints");
+
+    if (is_bottom())
+        return;
+    for (const linear_constraint_t& cst : csts) {
+        if (cst.is_contradiction()) {
+            set_to_bottom();
+            return;
+        }
+    }
+    normalize();
+
+    bool pending = false;
+    for (const linear_constraint_t& cst : csts) {
+        if (cst.is_tautology())
+            continue;
+        if (!is_deferrable(cst)) {
+            if (pending) {
+                close_bounds();
+                pending = false;
+            }
+            add_constraint(cst);
+            if (is_bottom())
+                return;
+            continue;
+        }
+        const linear_expression_t& exp = cst.expression();
+        bool ok;
+        if (cst.is_inequality()) {
+            ok = add_linear_leq(exp, false);
+        } else if (cst.is_strict_inequality()) {
+            // e < 0 --> e <= -1
+            ok = add_linear_leq(exp + 1, false);
+        } else {
+            ok = add_linear_leq(exp, false) && add_linear_leq(-exp, false);
+        }
+        if (!ok) {
+            set_to_bottom();
+            return;
+        }
+        pending = true;
+    }
+    if (pending) {
+        close_bounds();
+    }
+    CRAB_LOG("zones-split", std::cout << "--- batch of " << csts.size() << "\n" << *this << "\n");
+}
 
+void SplitDBM::add_constraint(const linear_constraint_t& cst) {
     if (cst.is_tautology())
         return;
 
@@ -955,7 +1106,7 @@ void SplitDBM::assign(variable_t x, const linear_expression_t& e) {
             }
             // Clear the old x vertex
             operator-=(x);
-            vert_map.insert(vmap_elt_t(x, vert));
+            vert_map.insert(x, vert);
         } else {
             set(x, x_int);
         }
@@ -986,16 +1137,17 @@ void SplitDBM::rename(const variable_vector_t& from, const variable_vector_t& to
              std::cout << "}:\n"; std::cout << *this << "\n";);
 
     vert_map_t new_vert_map;
-    for (auto kv : vert_map) {
-        ptrdiff_t pos = std::distance(from.begin(), std::find(from.begin(), from.end(), kv.first));
+    vert_map.for_each([&](vert_id n) {
+        variable_t v = *rev_map[n];
+        ptrdiff_t pos = std::distance(from.begin(), std::find(from.begin(), from.end(), v));
         if ((long unsigned)pos < from.size()) {
             variable_t new_v(to[pos]);
-            new_vert_map.insert(vmap_elt_t(new_v, kv.second));
-            rev_map[kv.second] = new_v;
+            new_vert_map.insert(new_v, n);
+            rev_map[n] = new_v;
         } else {
-            new_vert_map.insert(kv);
+            new_vert_map.insert(v, n);
         }
-    }
+    });
     std::swap(vert_map, new_vert_map);
 
     CRAB_LOG("zones-split", std::cout << "RESULT=" << *this << "\n");
@@ -1048,6 +1200,50 @@ void SplitDBM::normalize() {
     unstable.clear();
 }
 
+interval_t SplitDBM::eval_relational_interval(const linear_expression_t& e) const {
+    interval_t r = eval_interval(e);
+    if (r.is_bottom() || e.size() != 2) {
+        return r;
+    }
+    auto first = e.begin();
+    auto second = std::next(first);
+    variable_t x = first->first, y = second->first;
+    if (first->second == -1 && second->second == 1) {
+        std::swap(x, y);
+    } else if (!(first->second == 1 && second->second == -1)) {
+        return r;
+    }
+    // e = x - y + k
+    std::optional<vert_id> vx = vert_map.find(x);
+    std::optional<vert_id> vy = vert_map.find(y);
+    if (!vx || !vy) {
+        return r;
+    }
+    // An edge s -> d of weight w stands for d - s <= w.
+    std::optional<Wt> ub = g.lookup(*vy, *vx);
+    std::optional<Wt> neg_lb = g.lookup(*vx, *vy);
+    interval_t diff(neg_lb ? bound_t(-number_t(*neg_lb)) : bound_t::minus_infinity(),
+                    ub ? bound_t(number_t(*ub)) : bound_t::plus_infinity());
+    return r & (diff + interval_t(e.constant()));
+}
+
+std::optional<interval_t> SplitDBM::eval_unit_interval(const linear_expression_t& e) {
+    if (e.size() > 2) {
+        return {};
+    }
+    for (const auto& [x, n] : e) {
+        if (n != 1 && n != -1) {
+            return {};
+        }
+    }
+    if (e.size() == 2 && std::next(e.begin())->second == e.begin()->second) {
+        return {};
+    }
+    // Edges are only guaranteed to be tight once pending widening results are closed.
+    normalize();
+    return eval_relational_interval(e);
+}
+
 void SplitDBM::set(variable_t x, const interval_t& intv) {
     CrabStats::count("SplitDBM.count.assign");
     ScopedCrabStats __st__("SplitDBM.assign");
@@ -1182,12 +1378,17 @@ void SplitDBM::forget(const variable_vector_t& variables) {
         return;
     }
 
+    normalize();
+
+    std::vector<vert_id> verts;
     for (auto v : variables) {
-        auto it = vert_map.find(v);
-        if (it != vert_map.end()) {
-            operator-=(v);
+        if (auto vert = vert_map.find(v)) {
+            verts.push_back(*vert);
+            rev_map[*vert] = std::nullopt;
+            vert_map.erase(v);
         }
     }
+    g.forget(verts);
 }
 
 std::ostream& operator<<(std::ostream& o, SplitDBM& dom) {
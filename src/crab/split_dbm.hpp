@@ -19,11 +19,13 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
 #include <optional>
 #include <type_traits>
 #include <unordered_set>
 
-#include <boost/container/flat_map.hpp>
+#include <boost/container/small_vector.hpp>
 #include <utility>
 
 #include "crab/interval.hpp"
@@ -83,6 +85,105 @@ inline SafeInt64DefaultParams::Wt convert_NtoW(const z_number& n, bool& overflow
     return SafeInt64DefaultParams::Wt(n);
 }
 
+/**
+ * Map from variables to graph vertices, indexed directly by variable id.
+ * Ids are small dense integers, so the map is a table of fixed-size pages
+ * that are allocated on first use and shared between copies until one of
+ * them writes to the page. Vertex 0 is never mapped, so it marks an empty
+ * slot.
+ **/
+class VertMap final {
+  public:
+    using vert_id = AdaptGraph::vert_id;
+
+  private:
+    static constexpr size_t page_bits = 6;
+    static constexpr size_t page_size = size_t{1} << page_bits;
+    using page_t = std::array<vert_id, page_size>;
+
+    std::vector<std::shared_ptr<page_t>> pages;
+    size_t _size{};
+
+    vert_id& slot(variable_t v) {
+        size_t p = v.index() >> page_bits;
+        if (p >= pages.size()) {
+            pages.resize(p + 1);
+        }
+        std::shared_ptr<page_t>& page = pages[p];
+        if (!page) {
+            page = std::make_shared<page_t>();
+        } else if (page.use_count() > 1) {
+            page = std::make_shared<page_t>(*page);
+        }
+        return (*page)[v.index() & (page_size - 1)];
+    }
+
+  public:
+    [[nodiscard]] std::optional<vert_id> find(variable_t v) const {
+        size_t p = v.index() >> page_bits;
+        if (p >= pages.size() || !pages[p]) {
+            return {};
+        }
+        vert_id vert = (*pages[p])[v.index() & (page_size - 1)];
+        if (vert == 0) {
+            return {};
+        }
+        return vert;
+    }
+
+    // Like std::map::insert, this does nothing if v is already mapped.
+    void insert(variable_t v, vert_id vert) {
+        assert(vert != 0);
+        vert_id& s = slot(v);
+        if (s == 0) {
+            s = vert;
+            ++_size;
+        }
+    }
+
+    void erase(variable_t v) {
+        if (find(v)) {
+            slot(v) = 0;
+            --_size;
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+    // Call f on each mapped vertex, in increasing order of variable id.
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto& page : pages) {
+            if (page) {
+                for (vert_id vert : *page) {
+                    if (vert != 0) {
+                        f(vert);
+                    }
+                }
+            }
+        }
+    }
+
+    // Call f on each vertex mapped from a variable with an id in [lb, ub],
+    // in increasing order of variable id.
+    template <typename F>
+    void for_each(variable_t lb, variable_t ub, F f) const {
+        for (size_t p = lb.index() >> page_bits; p < pages.size() && p <= (ub.index() >> page_bits); p++) {
+            if (!pages[p]) {
+                continue;
+            }
+            size_t first = std::max<size_t>(lb.index(), p << page_bits) & (page_size - 1);
+            size_t last = std::min<size_t>(ub.index(), (p << page_bits) + page_size - 1) & (page_size - 1);
+            for (size_t i = first; i <= last; i++) {
+                vert_id vert = (*pages[p])[i];
+                if (vert != 0) {
+                    f(vert);
+                }
+            }
+        }
+    }
+};
+
 class SplitDBM final {
   private:
     using variable_vector_t = std::vector<variable_t>;
@@ -91,14 +192,15 @@ class SplitDBM final {
     using Wt = typename Params::Wt;
     using graph_t = typename Params::graph_t;
     using vert_id = typename graph_t::vert_id;
-    using vert_map_t = boost::container::flat_map<variable_t, vert_id>;
-    using vmap_elt_t = typename vert_map_t::value_type;
+    using vert_map_t = VertMap;
     using rev_map_t = std::vector<std::optional<variable_t>>;
     using GrOps = GraphOps<graph_t>;
     using GrPerm = GraphPerm<graph_t>;
     using edge_vector = typename GrOps::edge_vector;
     // < <x, y>, k> == x - y <= k.
     using diffcst_t = std::pair<std::pair<variable_t, variable_t>, Wt>;
+    using diffcst_vector_t = boost::container::small_vector<diffcst_t, 2>;
+    using bound_vector_t = boost::container::small_vector<std::pair<variable_t, Wt>, 2>;
     using vert_set_t = std::unordered_set<vert_id>;
 
   private:
@@ -125,9 +227,8 @@ class SplitDBM final {
 
     // Evaluate the potential value of a variable.
     Wt pot_value(variable_t v) {
-        auto it = vert_map.find(v);
-        if (it != vert_map.end())
-            return potential[(*it).second];
+        if (auto vert = vert_map.find(v))
+            return potential[*vert];
         return ((Wt)0);
     }
 
@@ -192,13 +293,30 @@ class SplitDBM final {
      **/
     void diffcsts_of_lin_leq(const linear_expression_t& exp,
                              /* difference contraints */
-                             std::vector<diffcst_t>& csts,
+                             diffcst_vector_t& csts,
                              /* x >= lb for each {x,lb} in lbs */
-                             std::vector<std::pair<variable_t, Wt>>& lbs,
+                             bound_vector_t& lbs,
                              /* x <= ub for each {x,ub} in ubs */
-                             std::vector<std::pair<variable_t, Wt>>& ubs);
+                             bound_vector_t& ubs);
+
+    // Fast path of diffcsts_of_lin_leq for x - y + k <= 0. Returns false
+    // if exp does not have that shape, or its bounds do not fit in Wt.
+    bool diffcsts_of_unit_lin_leq(const linear_expression_t& exp, const Wt& exp_ub, diffcst_vector_t& csts,
+                                  bound_vector_t& lbs, bound_vector_t& ubs);
+
+    // If close is false, the bounds are left for the caller to restore
+    // with close_bounds(), so that several constraints can share it.
+    bool add_linear_leq(const linear_expression_t& exp, bool close = true);
+
+    // Restore the closure of the edges to and from vertex 0.
+    void close_bounds();
+
+    // True if cst turns into difference constraints and bounds that do
+    // not depend on the bounds of other variables, so that restoring the
+    // closure can be deferred without losing precision.
+    static bool is_deferrable(const linear_constraint_t& cst);
 
-    bool add_linear_leq(const linear_expression_t& exp);
+    void add_constraint(const linear_constraint_t& cst);
 
     // x != n
     void add_univar_disequation(variable_t x, const number_t& n);
@@ -213,17 +331,18 @@ class SplitDBM final {
         }
     }
 
-    interval_t get_interval(variable_t x) { return get_interval(vert_map, g, x); }
+    interval_t get_interval(variable_t x) const { return get_interval(vert_map, g, x); }
 
-    static interval_t get_interval(vert_map_t& m, graph_t& r, variable_t x) {
-        auto it = m.find(x);
-        if (it == m.end()) {
+    static interval_t get_interval(const vert_map_t& m, const graph_t& r, variable_t x) {
+        std::optional<vert_id> v = m.find(x);
+        if (!v) {
             return interval_t::top();
         }
-        vert_id v = (*it).second;
-        interval_t x_out = interval_t(r.elem(v, 0) ? -number_t(r.edge_val(v, 0)) : bound_t::minus_infinity(),
-                                      r.elem(0, v) ? number_t(r.edge_val(0, v)) : bound_t::plus_infinity());
-        return x_out;
+        std::optional<Wt> w_lb = r.lookup(*v, 0);
+        std::optional<Wt> w_ub = r.lookup(0, *v);
+        bound_t lb = w_lb ? bound_t(-number_t(*w_lb)) : bound_t::minus_infinity();
+        bound_t ub = w_ub ? bound_t(number_t(*w_ub)) : bound_t::plus_infinity();
+        return interval_t(lb, ub);
     }
 
     // Resore potential after an edge addition
@@ -282,7 +401,7 @@ class SplitDBM final {
         return g.is_empty();
     }
 
-    bool operator<=(SplitDBM o);
+    bool operator<=(const SplitDBM& o);
 
     // FIXME: can be done more efficient
     void operator|=(const SplitDBM& o) { *this = *this | o; }
@@ -303,10 +422,7 @@ class SplitDBM final {
 
     SplitDBM widen(SplitDBM o);
 
-    SplitDBM widening_thresholds(SplitDBM o, const iterators::thresholds_t& ts) {
-        // TODO: use thresholds
-        return ((*this).widen(std::move(o)));
-    }
+    SplitDBM widening_thresholds(SplitDBM o, const iterators::thresholds_t& ts);
 
     SplitDBM operator&(SplitDBM o);
 
@@ -355,14 +471,33 @@ class SplitDBM final {
 
     void operator+=(const linear_constraint_t& cst);
 
-    interval_t eval_interval(const linear_expression_t& e) {
+    // Add several constraints at once, restoring closure only once for
+    // each run of difference constraints.
+    void operator+=(const std::vector<linear_constraint_t>& csts);
+
+    interval_t eval_interval(const linear_expression_t& e) const {
         interval_t r{e.constant()};
         for (auto [v, n] : e)
             r += n * operator[](v);
         return r;
     }
 
-    interval_t operator[](variable_t x) {
+    // Like eval_interval, but an expression x - y + k is also bounded by
+    // the difference constraints between x and y.
+    interval_t eval_relational_interval(const linear_expression_t& e) const;
+
+    // Exact bounds of e if it is k, x + k, -x + k or x - y + k, read off the closed graph
+    // without copying it. Empty for any other shape.
+    std::optional<interval_t> eval_unit_interval(const linear_expression_t& e);
+
+    // Call f on each variable with an id in [lb, ub] that the DBM tracks,
+    // in increasing order of id.
+    template <typename F>
+    void for_each_variable(variable_t lb, variable_t ub, F f) const {
+        vert_map.for_each(lb, ub, [&](vert_id v) { f(*rev_map[v]); });
+    }
+
+    interval_t operator[](variable_t x) const {
         CrabStats::count("SplitDBM.count.to_intervals");
         ScopedCrabStats __st__("SplitDBM.to_intervals");
 
@@ -375,6 +510,7 @@ class SplitDBM final {
 
     void set(variable_t x, const interval_t& intv);
 
+    // Same as -= on each variable, but removes their vertices in one sweep.
     void forget(const variable_vector_t& variables);
 
     void rename(const variable_vector_t& from, const variable_vector_t& to);
@@ -415,6 +551,16 @@ class SplitDBM final {
             return false;
         if (is_top() || cst.is_tautology())
             return true;
+        if (!cst.is_disequation()) {
+            if (std::optional<interval_t> r = eval_unit_interval(cst.expression())) {
+                switch (cst.kind()) {
+                case cst_kind::EQUALITY: return (*r)[number_t(0)];
+                case cst_kind::INEQUALITY: return r->lb() <= bound_t{0};
+                case cst_kind::STRICT_INEQUALITY: return r->lb() < bound_t{0};
+                default: break;
+                }
+            }
+        }
         return intersect_aux(cst);
     }
 
@@ -427,6 +573,17 @@ class SplitDBM final {
         if (rhs.is_contradiction())
             return false;
 
+        if (!rhs.is_disequation()) {
+            if (std::optional<interval_t> r = eval_unit_interval(rhs.expression())) {
+                switch (rhs.kind()) {
+                case cst_kind::EQUALITY: return r->lb() >= bound_t{0} && r->ub() <= bound_t{0};
+                case cst_kind::INEQUALITY: return r->ub() <= bound_t{0};
+                case cst_kind::STRICT_INEQUALITY: return r->ub() < bound_t{0};
+                default: break;
+                }
+            }
+        }
+
         if (rhs.is_equality()) {
             // try to convert the equality into inequalities so when it's
             // negated we do not have disequalities.
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "crab/thresholds.hpp"
 #include "crab/cfg.hpp"
+#include "crab/ebpf_domain.hpp"
 
 namespace crab {
 
@@ -35,6 +36,16 @@ void thresholds_t::add(bound_t v1) {
     }
 }
 
+bound_t thresholds_t::get_next(const bound_t& v) const {
+    // m_thresholds is sorted and always ends with +oo.
+    return *std::lower_bound(m_thresholds.begin(), m_thresholds.end(), v);
+}
+
+bound_t thresholds_t::get_prev(const bound_t& v) const {
+    // m_thresholds is sorted and always starts with -oo.
+    return *std::prev(std::upper_bound(m_thresholds.begin(), m_thresholds.end(), v));
+}
+
 std::ostream& operator<<(std::ostream& o, const thresholds_t& t) {
     o << "{";
     for (typename std::vector<bound_t>::const_iterator it = t.m_thresholds.begin(), et = t.m_thresholds.end(); it != et;) {
@@ -49,7 +60,26 @@ std::ostream& operator<<(std::ostream& o, const thresholds_t& t) {
 }
 
 void wto_thresholds_t::get_thresholds(const basic_block_t& bb, thresholds_t& thresholds) const {
+    for (const Instruction& ins : bb) {
+        if (const auto* assume = std::get_if<Assume>(&ins)) {
+            // Loop exit tests against a constant bound the loop counter.
+            if (const auto* imm = std::get_if<Imm>(&assume->cond.right)) {
+                thresholds.add(bound_t{number_t{(int64_t)imm->v}});
+            }
+        } else if (const auto* load = std::get_if<LoadMapFd>(&ins)) {
+            // Offsets into a map value are bounded by its size.
+            EbpfMapDescriptor& desc = global_program_info.platform->get_map_descriptor(load->mapfd);
+            thresholds.add(bound_t{number_t{desc.value_size}});
+        }
+    }
+}
 
+const thresholds_t& wto_thresholds_t::get_thresholds(const label_t& head) const {
+    auto it = m_head_to_thresholds.find(head);
+    if (it == m_head_to_thresholds.end()) {
+        CRAB_ERROR("No thresholds collected for ", head);
+    }
+    return it->second;
 }
 
 void wto_thresholds_t::operator()(wto_vertex_t& vertex) {
@@ -69,6 +99,9 @@ void wto_thresholds_t::operator()(wto_vertex_t& vertex) {
 
 void wto_thresholds_t::operator()(wto_cycle_t& cycle) {
     thresholds_t thresholds(m_max_size);
+    // Pointer offsets never exceed the stack or the largest packet.
+    thresholds.add(bound_t{EBPF_STACK_SIZE});
+    thresholds.add(bound_t{domains::MAX_PACKET_OFF});
     auto& bb = m_cfg.get_node(cycle.head());
     get_thresholds(bb, thresholds);
 
@@ -37,8 +37,17 @@ class thresholds_t final {
 
     size_t size() const { return m_thresholds.size(); }
 
+    [[nodiscard]] std::vector<bound_t>::const_iterator begin() const { return m_thresholds.begin(); }
+    [[nodiscard]] std::vector<bound_t>::const_iterator end() const { return m_thresholds.end(); }
+
     void add(bound_t v1);
 
+    // Return the smallest threshold that is not below v.
+    [[nodiscard]] bound_t get_next(const bound_t& v) const;
+
+    // Return the largest threshold that is not above v.
+    [[nodiscard]] bound_t get_prev(const bound_t& v) const;
+
     friend std::ostream& operator<<(std::ostream& o, const thresholds_t& t);
 };
 
@@ -61,6 +70,9 @@ class wto_thresholds_t final {
   public:
     wto_thresholds_t(cfg_t& cfg, size_t max_size) : m_cfg(cfg), m_max_size(max_size) {}
 
+    // Thresholds collected for the cycle headed by head.
+    [[nodiscard]] const thresholds_t& get_thresholds(const label_t& head) const;
+
     void operator()(wto_vertex_t& vertex);
 
     void operator()(wto_cycle_t& cycle);
@@ -4,36 +4,14 @@
  * Factories for variable names.
  */
 
+#include <algorithm>
+#include <sstream>
+#include <tuple>
+
 #include "crab/variable.hpp"
 
 namespace crab {
 
-variable_t variable_t::make(const std::string& name) {
-    auto it = std::find(names.begin(), names.end(), name);
-    if (it == names.end()) {
-        names.emplace_back(name);
-        return variable_t(names.size() - 1);
-    } else {
-        return variable_t(std::distance(names.begin(), it));
-    }
-}
-
-std::vector<std::string> variable_t::names{
-    "r0.value",    "r0.offset",  "r0.type",
-    "r1.value",    "r1.offset",  "r1.type",
-    "r2.value",    "r2.offset",  "r2.type",
-    "r3.value",    "r3.offset",  "r3.type",
-    "r4.value",    "r4.offset",  "r4.type",
-    "r5.value",    "r5.offset",  "r5.type",
-    "r6.value",    "r6.offset",  "r6.type",
-    "r7.value",    "r7.offset",  "r7.type",
-    "r8.value",    "r8.offset",  "r8.type",
-    "r9.value",    "r9.offset",  "r9.type",
-    "r10.value",   "r10.offset", "r10.type",
-    "S.value",     "S.offset",   "S.type",
-    "data_size",   "meta_size",  "map_value_size",
-    "map_key_size"};
-
 static std::string name_of(data_kind_t kind) {
     switch (kind) {
     case data_kind_t::offsets: return "offset";
@@ -43,8 +21,8 @@ static std::string name_of(data_kind_t kind) {
     return {};
 }
 
-variable_t variable_t::reg(data_kind_t kind, int i) {
-    return make("r" + std::to_string(i) + "." + name_of(kind)); }
+// Inverse of variable_t::kind_index().
+static constexpr data_kind_t kinds[] = {data_kind_t::values, data_kind_t::offsets, data_kind_t::types};
 
 std::ostream& operator<<(std::ostream& o, const data_kind_t& s) {
     return o << name_of(s);
@@ -60,14 +38,122 @@ static std::string mk_scalar_name(data_kind_t kind, int o, int size) {
     return os.str();
 }
 
+// The registry of the analysis running on this thread, if any.
+static thread_local cell_registry_t* current_cells = nullptr;
+
+cell_registry_t::cell_registry_t() : previous(current_cells) { current_cells = this; }
+
+cell_registry_t::~cell_registry_t() { current_cells = previous; }
+
+const cell_registry_t::cell_key_t* variable_t::interned_cell(index_t id) {
+    if (current_cells == nullptr || id - first_interned_cell >= current_cells->cells.size()) {
+        return nullptr;
+    }
+    return &current_cells->cells[id - first_interned_cell];
+}
+
+static std::optional<index_t> size_index(unsigned size) {
+    switch (size) {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    case 8: return 3;
+    default: return {};
+    }
+}
+
 variable_t variable_t::cell_var(data_kind_t array, index_t offset, unsigned size) {
-    return make(mk_scalar_name(array, - (512 - (int)offset), (int)size));
+    if (offset < stack_size) {
+        if (std::optional<index_t> s = size_index(size)) {
+            return variable_t(first_cell + (kind_index(array) * stack_size + offset) * 4 + *s);
+        }
+    }
+    if (current_cells == nullptr) {
+        CRAB_ERROR("stack cell of size ", size, " at offset ", offset, " outside of an analysis");
+    }
+    cell_registry_t::cell_key_t key{array, offset, size};
+    auto [it, inserted] = current_cells->ids.emplace(key, first_interned_cell + current_cells->cells.size());
+    if (inserted) {
+        current_cells->cells.push_back(key);
+    }
+    return variable_t(it->second);
 }
 
-variable_t variable_t::map_value_size() { return make("map_value_size"); }
-variable_t variable_t::map_key_size() { return make("map_key_size"); }
-variable_t variable_t::meta_offset() { return make("meta_offset"); }
-variable_t variable_t::packet_size() { return make("packet_size"); }
-variable_t variable_t::instruction_count() { return make("instruction_count"); }
+std::optional<std::pair<variable_t, variable_t>> variable_t::cell_vars(data_kind_t array, index_t lb, index_t ub) {
+    if (lb > ub || lb >= stack_size) {
+        return {};
+    }
+    ub = std::min(ub, stack_size - 1);
+    index_t base = first_cell + kind_index(array) * stack_size * 4;
+    return std::make_pair(variable_t(base + lb * 4), variable_t(base + ub * 4 + 3));
+}
+
+std::pair<variable_t, variable_t> variable_t::interned_cell_vars() {
+    return {variable_t(first_interned_cell), variable_t(std::numeric_limits<index_t>::max())};
+}
+
+std::optional<std::pair<index_t, unsigned>> variable_t::cell_of(data_kind_t array) const {
+    if (_id < first_cell) {
+        return {};
+    }
+    if (_id < first_interned_cell) {
+        index_t rel = _id - first_cell;
+        if (kinds[rel / 4 / stack_size] != array) {
+            return {};
+        }
+        return std::make_pair((rel / 4) % stack_size, 1u << (rel % 4));
+    }
+    const cell_registry_t::cell_key_t* cell = interned_cell(_id);
+    if (cell == nullptr) {
+        return {};
+    }
+    auto [kind, offset, size] = *cell;
+    if (kind != array) {
+        return {};
+    }
+    return std::make_pair(offset, size);
+}
+
+std::string variable_t::name() const {
+    if (_id < first_special) {
+        return "r" + std::to_string(_id / 3) + "." + name_of(kinds[_id % 3]);
+    }
+    switch (_id) {
+    case map_value_size_id: return "map_value_size";
+    case map_key_size_id: return "map_key_size";
+    case meta_offset_id: return "meta_offset";
+    case packet_size_id: return "packet_size";
+    case instruction_count_id: return "instruction_count";
+    default: break;
+    }
+    data_kind_t kind;
+    index_t offset;
+    unsigned size;
+    if (_id < first_interned_cell) {
+        index_t rel = _id - first_cell;
+        size = 1u << (rel % 4);
+        offset = (rel / 4) % stack_size;
+        kind = kinds[rel / 4 / stack_size];
+    } else if (const cell_registry_t::cell_key_t* cell = interned_cell(_id)) {
+        std::tie(kind, offset, size) = *cell;
+    } else {
+        return "cell#" + std::to_string(_id);
+    }
+    return mk_scalar_name(kind, -(512 - (int)offset), (int)size);
+}
+
+bool variable_t::is_type() const {
+    if (_id < first_special) {
+        return kinds[_id % 3] == data_kind_t::types;
+    }
+    if (_id < first_cell) {
+        return false;
+    }
+    if (_id < first_interned_cell) {
+        return kinds[(_id - first_cell) / 4 / stack_size] == data_kind_t::types;
+    }
+    const cell_registry_t::cell_key_t* cell = interned_cell(_id);
+    return cell != nullptr && std::get<data_kind_t>(*cell) == data_kind_t::types;
+}
 
 } // end namespace crab
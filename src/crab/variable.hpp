@@ -5,8 +5,12 @@
 #include <iosfwd>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "crab_utils/bignums.hpp"
@@ -23,14 +27,44 @@ std::ostream& operator<<(std::ostream& o, const data_kind_t& s);
 
 // Wrapper for typed variables used by the crab abstract domains and linear_constraints.
 // Being a class (instead of a type alias) enables overloading in dsl_syntax
+//
+// Variable ids are computed rather than looked up: three per register
+// (value, offset, type), then the special variables, then one id per
+// (kind, offset, size) stack cell of size 1, 2, 4 or 8. Cells of any other
+// size get ids after that from the cell_registry_t of the running analysis.
+// Names are only built for printing.
 class variable_t final {
     index_t _id;
 
-    explicit variable_t(index_t id) : _id(id) {}
+    explicit constexpr variable_t(index_t id) : _id(id) {}
+
+    static constexpr index_t kind_index(data_kind_t kind) {
+        switch (kind) {
+        case data_kind_t::values: return 0;
+        case data_kind_t::offsets: return 1;
+        case data_kind_t::types: return 2;
+        }
+        return 0;
+    }
+
+    static constexpr int max_reg = 10;
+    static constexpr index_t first_special = 3 * (max_reg + 1);
+    enum : index_t { map_value_size_id = first_special, map_key_size_id, packet_size_id, meta_offset_id, instruction_count_id, first_cell };
+    static constexpr index_t stack_size = 512;
+    static constexpr index_t first_interned_cell = first_cell + 3 * stack_size * 4;
+
+    // The interned cell with the given id, if the current registry has it.
+    static const std::tuple<data_kind_t, index_t, unsigned>* interned_cell(index_t id);
 
   public:
     [[nodiscard]] std::size_t hash() const { return (size_t)_id; }
 
+    // Dense index, for containers indexed directly by variable.
+    [[nodiscard]] index_t index() const { return _id; }
+
+    // Inverse of index().
+    static constexpr variable_t of_index(index_t id) { return variable_t(id); }
+
     bool operator==(variable_t o) const { return _id == o._id; }
 
     bool operator!=(variable_t o) const { return (!(operator==(o))); }
@@ -39,28 +73,55 @@ class variable_t final {
     bool operator<(variable_t o) const { return _id < o._id; }
 
 
-    [[nodiscard]] std::string name() const { return names.at(_id); }
+    [[nodiscard]] std::string name() const;
 
-    bool is_type() { return names.at(_id).find(".type") != std::string::npos; }
+    [[nodiscard]] bool is_type() const;
 
-    friend std::ostream& operator<<(std::ostream& o, variable_t v)  { return o << names.at(v._id); }
+    friend std::ostream& operator<<(std::ostream& o, variable_t v) { return o << v.name(); }
 
     // var_factory portion.
     // This singleton is eBPF-specific, to avoid life time issues and/or passing factory explicitly everywhere:
-  private:
-    static variable_t make(const std::string& name);
-    static std::vector<std::string> names;
-
-  public:
-    static variable_t reg(data_kind_t, int);
+    static constexpr variable_t reg(data_kind_t kind, int i) { return variable_t(3 * i + kind_index(kind)); }
     static variable_t cell_var(data_kind_t array, index_t offset, unsigned size);
-    static variable_t map_value_size();
-    static variable_t map_key_size();
-    static variable_t meta_offset();
-    static variable_t packet_size();
-    static variable_t instruction_count();
+
+    // Return the ids of all cells of kind array that start at an offset in
+    // [lb, ub] and have a size of 1, 2, 4 or 8, as an inclusive range of
+    // variables. Any other cell lies in interned_cell_vars().
+    static std::optional<std::pair<variable_t, variable_t>> cell_vars(data_kind_t array, index_t lb, index_t ub);
+    static std::pair<variable_t, variable_t> interned_cell_vars();
+
+    // Offset and size of the cell of kind array this variable stands for, if any.
+    [[nodiscard]] std::optional<std::pair<index_t, unsigned>> cell_of(data_kind_t array) const;
+
+    static constexpr variable_t map_value_size() { return variable_t(map_value_size_id); }
+    static constexpr variable_t map_key_size() { return variable_t(map_key_size_id); }
+    static constexpr variable_t meta_offset() { return variable_t(meta_offset_id); }
+    static constexpr variable_t packet_size() { return variable_t(packet_size_id); }
+    static constexpr variable_t instruction_count() { return variable_t(instruction_count_id); }
 }; // class variable_t
 
+// Ids of stack cells whose size is not 1, 2, 4 or 8, interned on demand.
+// Each analysis owns one registry: constructing it makes it the registry
+// that variable_t uses on the current thread, until it is destroyed and the
+// ids it gave out become meaningless. Analyses on other threads have their
+// own registries.
+class cell_registry_t final {
+    friend class variable_t;
+
+    using cell_key_t = std::tuple<data_kind_t, index_t, unsigned>;
+
+    std::map<cell_key_t, index_t> ids;
+    // In order of creation; the cell with id first_interned_cell + i is cells[i].
+    std::vector<cell_key_t> cells;
+    cell_registry_t* previous;
+
+  public:
+    cell_registry_t();
+    ~cell_registry_t();
+    cell_registry_t(const cell_registry_t&) = delete;
+    cell_registry_t& operator=(const cell_registry_t&) = delete;
+};
+
 inline size_t hash_value(variable_t v) { return v.hash(); }
 
 } // namespace crab
@@ -220,6 +220,8 @@ class wto_cycle_t final {
 
     void increment_fixpo_visits() { _num_fixpo++; }
 
+    [[nodiscard]] unsigned fixpo_visits() const { return _num_fixpo; }
+
     friend std::ostream& operator<<(std::ostream& o, const wto_cycle_t& cycle) {
         o << "(" << cycle._head;
         if (!cycle._wto_components.empty()) {
@@ -447,10 +449,11 @@ class wto_t final {
 
     const_iterator end() const { return _wto_components.end(); }
 
+    /// Nodes unreachable from the entry are in no component; their nesting is empty.
     wto_nesting_t nesting(vertex_descriptor_t n) {
         auto it = this->_nesting_table.find(n);
         if (it == this->_nesting_table.end()) {
-            CRAB_ERROR("WTO nesting: node ", n, " not found");
+            return wto_nesting_t();
         } else {
             return it->second;
         }
@@ -2,7 +2,10 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <optional>
 
 #include "crab_utils/safeint.hpp"
 #include "crab_utils/debug.hpp"
@@ -235,6 +238,8 @@ class AdaptGraph final {
             is_free.push_back(false);
             _succs.emplace_back();
             _preds.emplace_back();
+            _from_zero.push_back(no_edge);
+            _to_zero.push_back(no_edge);
         }
 
         return v;
@@ -261,22 +266,68 @@ class AdaptGraph final {
         edge_count -= _preds[v].size();
         _preds[v].clear();
 
+        if (v == 0) {
+            std::fill(_from_zero.begin(), _from_zero.end(), no_edge);
+            std::fill(_to_zero.begin(), _to_zero.end(), no_edge);
+        } else {
+            _from_zero[v] = no_edge;
+            _to_zero[v] = no_edge;
+        }
+
         is_free[v] = true;
         free_id.push_back(v);
     }
 
+    // Like forget(v) for each of vs, in one sweep. The vertices are marked
+    // free first, so an edge between two of them is dropped without
+    // updating the adjacency of the other end.
+    // precondition: the vertices in vs are distinct, in use and not 0
+    void forget(const std::vector<vert_id>& vs) {
+        for (vert_id v : vs) {
+            assert(v != 0 && !is_free[v]);
+            is_free[v] = true;
+        }
+
+        for (vert_id v : vs) {
+            for (const auto& [key, val] : _succs[v].elts()) {
+                free_widx.push_back(val);
+                if (!is_free[key])
+                    _preds[key].remove(v);
+            }
+            edge_count -= _succs[v].size();
+            _succs[v].clear();
+
+            for (smap_t::key_t k : _preds[v].keys()) {
+                // Edges from a forgotten vertex were counted with its successors.
+                if (!is_free[k]) {
+                    _succs[k].remove(v);
+                    edge_count--;
+                }
+            }
+            _preds[v].clear();
+
+            _from_zero[v] = no_edge;
+            _to_zero[v] = no_edge;
+            free_id.push_back(v);
+        }
+    }
+
     void clear_edges() {
         _ws.clear();
         for (vert_id v : verts()) {
             _succs[v].clear();
             _preds[v].clear();
         }
+        std::fill(_from_zero.begin(), _from_zero.end(), no_edge);
+        std::fill(_to_zero.begin(), _to_zero.end(), no_edge);
         edge_count = 0;
     }
     void clear() {
         _ws.clear();
         _succs.clear();
         _preds.clear();
+        _from_zero.clear();
+        _to_zero.clear();
         is_free.clear();
         free_id.clear();
         free_widx.clear();
@@ -284,10 +335,10 @@ class AdaptGraph final {
         edge_count = 0;
     }
 
-    bool elem(vert_id s, vert_id d) { return _succs[s].contains(d); }
+    bool elem(vert_id s, vert_id d) { return edge_idx(s, d).has_value(); }
 
     Wt& edge_val(vert_id s, vert_id d) {
-        return _ws[*_succs[s].lookup(d)];
+        return _ws[*edge_idx(s, d)];
     }
 
     class mut_val_ref_t {
@@ -312,13 +363,20 @@ class AdaptGraph final {
     };
 
     bool lookup(vert_id s, vert_id d, mut_val_ref_t* w) {
-        if (auto idx = _succs[s].lookup(d)) {
+        if (auto idx = edge_idx(s, d)) {
             *w = &_ws[*idx];
             return true;
         }
         return false;
     }
 
+    [[nodiscard]] std::optional<Wt> lookup(vert_id s, vert_id d) const {
+        if (auto idx = edge_idx(s, d)) {
+            return _ws[*idx];
+        }
+        return {};
+    }
+
     void add_edge(vert_id s, Wt w, vert_id d) {
         size_t idx;
         if (!free_widx.empty()) {
@@ -332,11 +390,17 @@ class AdaptGraph final {
 
         _succs[s].add(d, idx);
         _preds[d].add(s, idx);
+        if (s == 0) {
+            _from_zero[d] = idx;
+        }
+        if (d == 0) {
+            _to_zero[s] = idx;
+        }
         edge_count++;
     }
 
     void update_edge(vert_id s, Wt w, vert_id d) {
-        if (auto idx = _succs[s].lookup(d)) {
+        if (auto idx = edge_idx(s, d)) {
             _ws[*idx] = std::min(_ws[*idx], w);
         } else {
             add_edge(s, w, d);
@@ -344,7 +408,7 @@ class AdaptGraph final {
     }
 
     void set_edge(vert_id s, Wt w, vert_id d) {
-        if (auto idx = _succs[s].lookup(d)) {
+        if (auto idx = edge_idx(s, d)) {
             _ws[*idx] = w;
         } else {
             add_edge(s, w, d);
@@ -388,5 +452,25 @@ class AdaptGraph final {
     std::vector<int> is_free;
     std::vector<vert_id> free_id;
     std::vector<size_t> free_widx;
+
+  private:
+    // Edges from and to vertex 0 hold the bounds of every other vertex,
+    // and are looked up far more often than any other edge, so their
+    // weight indices are also kept in dense per-vertex arrays.
+    static constexpr size_t no_edge = std::numeric_limits<size_t>::max();
+    std::vector<size_t> _from_zero;
+    std::vector<size_t> _to_zero;
+
+    [[nodiscard]] std::optional<size_t> edge_idx(vert_id s, vert_id d) const {
+        if (s == 0 && d != 0) {
+            size_t idx = _from_zero[d];
+            return idx == no_edge ? std::nullopt : std::optional<size_t>{idx};
+        }
+        if (d == 0 && s != 0) {
+            size_t idx = _to_zero[s];
+            return idx == no_edge ? std::nullopt : std::optional<size_t>{idx};
+        }
+        return _succs[s].lookup(d);
+    }
 };
 } // namespace crab
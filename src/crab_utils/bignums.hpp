@@ -3,6 +3,9 @@
 #ifdef BIGNUMS_GMP
 // Use the GMP library, which is under LGPLv3 and GNU GPLv2.
 # include "crab_utils/bignums_gmp.hpp"
+#elif defined(BIGNUMS_SMALLINT)
+// Use inline 64-bit integers, falling back to Boost on overflow.
+# include "crab_utils/bignums_smallint.hpp"
 #else
 // Use the Boost library, which is under BSL-1.0 (Boost Software License).
 # include "crab_utils/bignums_boost.hpp"
@@ -0,0 +1,340 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/functional/hash.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <utility>
+
+#include "debug.hpp"
+using boost::multiprecision::cpp_int;
+
+namespace crab {
+
+// Arbitrary-precision integer that keeps values fitting in 64 bits inline and
+// only falls back to boost's cpp_int (allocated on demand) when an operation
+// overflows. Almost every number seen while verifying eBPF code fits in an
+// int64_t, so bounds, intervals and linear expressions stay allocation-free.
+//
+// Invariant: _big is non-null iff the value does not fit in an int64_t, so
+// every value has a single representation and equality on the small path
+// is a plain integer comparison.
+class z_number final {
+  private:
+    int64_t _small{0};
+    std::unique_ptr<cpp_int> _big;
+
+    [[nodiscard]] bool is_small() const { return !_big; }
+
+    [[nodiscard]] cpp_int to_big() const { return is_small() ? cpp_int(_small) : *_big; }
+
+    void set_big(cpp_int n) {
+        if (n >= INT64_MIN && n <= INT64_MAX) {
+            _small = (int64_t)n;
+            _big.reset();
+        } else {
+            _small = 0;
+            if (_big)
+                *_big = std::move(n);
+            else
+                _big = std::make_unique<cpp_int>(std::move(n));
+        }
+    }
+
+    [[nodiscard]] std::string str() const { return is_small() ? std::to_string(_small) : _big->str(); }
+
+  public:
+    z_number() = default;
+    z_number(cpp_int n) { set_big(std::move(n)); }
+    explicit z_number(const std::string& s) { set_big(cpp_int(s)); }
+
+    z_number(signed long long int n) : _small(n) {}
+    z_number(unsigned long long int n) {
+        if (n <= (unsigned long long)INT64_MAX)
+            _small = (int64_t)n;
+        else
+            set_big(cpp_int(n));
+    }
+    z_number(int n) : _small(n) {}
+    z_number(unsigned int n) : _small(n) {}
+    z_number(long n) : _small(n) {}
+
+    z_number(const z_number& o) : _small(o._small), _big(o._big ? std::make_unique<cpp_int>(*o._big) : nullptr) {}
+    z_number(z_number&& o) noexcept = default;
+
+    z_number& operator=(const z_number& o) {
+        if (this != &o) {
+            _small = o._small;
+            if (o._big)
+                set_big(*o._big);
+            else
+                _big.reset();
+        }
+        return *this;
+    }
+    z_number& operator=(z_number&& o) noexcept = default;
+
+    // overloaded typecast operators
+    explicit operator long() const {
+        if (!fits_slong()) {
+            CRAB_ERROR("z_number ", str(), " does not fit into a signed long integer");
+        } else {
+            return (long)_small;
+        }
+    }
+
+    explicit operator int() const {
+        if (!fits_sint()) {
+            CRAB_ERROR("z_number ", str(), " does not fit into a signed integer");
+        } else {
+            return (int)_small;
+        }
+    }
+
+    explicit operator cpp_int() const { return to_big(); }
+
+    [[nodiscard]] std::size_t hash() const {
+        if (is_small()) {
+            return boost::hash<int64_t>{}(_small);
+        }
+        boost::hash<std::string> hasher;
+        return hasher(_big->str());
+    }
+
+    [[nodiscard]] bool fits_sint() const { return is_small() && _small >= INT_MIN && _small <= INT_MAX; }
+
+    [[nodiscard]] bool fits_slong() const { return is_small() && _small >= LONG_MIN && _small <= LONG_MAX; }
+
+    z_number operator+(const z_number& x) const {
+        int64_t r;
+        if (is_small() && x.is_small() && !__builtin_add_overflow(_small, x._small, &r)) {
+            return z_number((signed long long)r);
+        }
+        return z_number(to_big() + x.to_big());
+    }
+
+    z_number operator+(int x) const { return operator+(z_number(x)); }
+
+    z_number operator*(const z_number& x) const {
+        int64_t r;
+        if (is_small() && x.is_small() && !__builtin_mul_overflow(_small, x._small, &r)) {
+            return z_number((signed long long)r);
+        }
+        return z_number(to_big() * x.to_big());
+    }
+
+    z_number operator*(int x) const { return operator*(z_number(x)); }
+
+    z_number operator-(const z_number& x) const {
+        int64_t r;
+        if (is_small() && x.is_small() && !__builtin_sub_overflow(_small, x._small, &r)) {
+            return z_number((signed long long)r);
+        }
+        return z_number(to_big() - x.to_big());
+    }
+
+    z_number operator-(int x) const { return operator-(z_number(x)); }
+
+    z_number operator-() const {
+        if (is_small() && _small != INT64_MIN) {
+            return z_number((signed long long)-_small);
+        }
+        return z_number(-to_big());
+    }
+
+    z_number operator/(const z_number& x) const {
+        if (x == 0) {
+            CRAB_ERROR("z_number: division by zero [1]");
+        } else if (is_small() && x.is_small() && !(_small == INT64_MIN && x._small == -1)) {
+            return z_number((signed long long)(_small / x._small));
+        } else {
+            return z_number(to_big() / x.to_big());
+        }
+    }
+
+    z_number operator/(int x) const { return operator/(z_number(x)); }
+
+    z_number operator%(const z_number& x) const {
+        if (x == 0) {
+            CRAB_ERROR("z_number: division by zero [2]");
+        } else if (is_small() && x.is_small()) {
+            // INT64_MIN % -1 traps on some targets even though the result is 0.
+            return z_number((signed long long)(x._small == -1 ? 0 : _small % x._small));
+        } else {
+            return z_number(to_big() % x.to_big());
+        }
+    }
+
+    z_number operator%(int x) const { return operator%(z_number(x)); }
+
+    z_number& operator+=(const z_number& x) { return *this = *this + x; }
+
+    z_number& operator+=(int x) { return operator+=(z_number(x)); }
+
+    z_number& operator*=(const z_number& x) { return *this = *this * x; }
+
+    z_number& operator*=(int x) { return operator*=(z_number(x)); }
+
+    z_number& operator-=(const z_number& x) { return *this = *this - x; }
+
+    z_number& operator-=(int x) { return operator-=(z_number(x)); }
+
+    z_number& operator/=(const z_number& x) {
+        if (x == 0) {
+            CRAB_ERROR("z_number: division by zero [3]");
+        } else {
+            return *this = *this / x;
+        }
+    }
+
+    z_number& operator/=(int x) { return operator/=(z_number(x)); }
+
+    z_number& operator%=(const z_number& x) {
+        if (x == 0) {
+            CRAB_ERROR("z_number: division by zero [4]");
+        } else {
+            return *this = *this % x;
+        }
+    }
+
+    z_number& operator%=(int x) { return operator%=(z_number(x)); }
+
+    z_number& operator--() & { return *this -= 1; }
+
+    z_number& operator++() & { return *this += 1; }
+
+    z_number operator++(int) & {
+        z_number r(*this);
+        ++(*this);
+        return r;
+    }
+
+    z_number operator--(int) & {
+        z_number r(*this);
+        --(*this);
+        return r;
+    }
+
+    bool operator==(const z_number& x) const {
+        if (is_small() && x.is_small()) {
+            return _small == x._small;
+        }
+        return is_small() == x.is_small() && *_big == *x._big;
+    }
+
+    bool operator==(int x) const { return is_small() && _small == x; }
+
+    bool operator!=(const z_number& x) const { return !operator==(x); }
+
+    bool operator!=(int x) const { return !operator==(x); }
+
+    bool operator<(const z_number& x) const {
+        if (is_small() && x.is_small()) {
+            return _small < x._small;
+        }
+        return to_big() < x.to_big();
+    }
+
+    bool operator<(int x) const { return operator<(z_number(x)); }
+
+    bool operator<=(const z_number& x) const { return !x.operator<(*this); }
+
+    bool operator<=(int x) const { return operator<=(z_number(x)); }
+
+    bool operator>(const z_number& x) const { return x.operator<(*this); }
+
+    bool operator>(int x) const { return operator>(z_number(x)); }
+
+    bool operator>=(const z_number& x) const { return !operator<(x); }
+
+    bool operator>=(int x) const { return operator>=(z_number(x)); }
+
+    // Bitwise operators follow two's complement semantics, as cpp_int does.
+    z_number operator&(const z_number& x) const {
+        if (is_small() && x.is_small()) {
+            return z_number((signed long long)(_small & x._small));
+        }
+        return z_number(to_big() & x.to_big());
+    }
+
+    z_number operator&(int x) const { return operator&(z_number(x)); }
+
+    z_number operator|(const z_number& x) const {
+        if (is_small() && x.is_small()) {
+            return z_number((signed long long)(_small | x._small));
+        }
+        return z_number(to_big() | x.to_big());
+    }
+
+    z_number operator|(int x) const { return operator|(z_number(x)); }
+
+    z_number operator^(const z_number& x) const {
+        if (is_small() && x.is_small()) {
+            return z_number((signed long long)(_small ^ x._small));
+        }
+        return z_number(to_big() ^ x.to_big());
+    }
+
+    z_number operator^(int x) const { return operator^(z_number(x)); }
+
+    z_number operator<<(z_number x) const {
+        if (!x.fits_sint()) {
+            CRAB_ERROR("z_number ", x.str(), " does not fit into an int");
+        }
+        return operator<<((int)x);
+    }
+
+    z_number operator<<(int x) const {
+        int64_t r;
+        if (is_small() && x >= 0 && x < 63 && !__builtin_mul_overflow(_small, (int64_t)1 << x, &r)) {
+            return z_number((signed long long)r);
+        }
+        return z_number(to_big() << x);
+    }
+
+    z_number operator>>(z_number x) const {
+        if (!x.fits_sint()) {
+            CRAB_ERROR("z_number ", x.str(), " does not fit into an int");
+        }
+        return operator>>((int)x);
+    }
+
+    z_number operator>>(int x) const {
+        if (is_small() && x >= 0) {
+            // Arithmetic shift, rounding towards minus infinity like cpp_int.
+            return z_number((signed long long)(x >= 63 ? (_small < 0 ? -1 : 0) : _small >> x));
+        }
+        return z_number(to_big() >> x);
+    }
+
+    [[nodiscard]] z_number fill_ones() const {
+        if (*this == 0) {
+            return z_number((signed long long)0);
+        }
+
+        z_number result;
+        for (result = 1; result < *this; result = result * 2 + 1)
+            ;
+        return result;
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, const z_number& z) {
+        if (z.is_small()) {
+            return o << z._small;
+        }
+        return o << z._big->str();
+    }
+
+}; // class z_number
+
+using number_t = z_number;
+
+inline std::size_t hash_value(const z_number& z) { return z.hash(); }
+
+} // namespace crab
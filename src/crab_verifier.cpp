@@ -141,11 +141,12 @@ static void print_report(std::ostream& s, const checks_db& db, const Instruction
 
 static checks_db get_ebpf_report(std::ostream& s, cfg_t& cfg, program_info info, const ebpf_verifier_options_t* options) {
     global_program_info = std::move(info);
-    crab::domains::clear_global_state();
+    // Stack cells of unusual sizes, for as long as the invariants are in use.
+    crab::cell_registry_t cells;
 
     // Get dictionaries of preconditions and postconditions for each
     // basic block.
-    auto [preconditions, postconditions] = crab::run_forward_analyzer(cfg, options->check_termination);
+    auto [preconditions, postconditions] = crab::run_forward_analyzer(cfg, *options);
 
     // Analyze the control-flow graph.
     return generate_report(s, cfg, preconditions, postconditions, *options);
@@ -15,6 +15,9 @@
 #endif
 #include "linux_verifier.hpp"
 #include "utils.hpp"
+#ifdef TRACE_DOMAIN
+#include "crab/domain_trace.hpp"
+#endif
 
 using std::string;
 using std::vector;
@@ -56,16 +59,35 @@ int main(int argc, char** argv) {
     app.add_flag("-v", verbose, "Print both invariants and failures");
     app.add_flag("--no-simplify", ebpf_verifier_options.no_simplify, "Do not simplify");
 
+    fixpoint_strategy_t& fixpoint = ebpf_verifier_options.fixpoint;
+    app.add_option("--widening-delay", fixpoint.widening_delay,
+                   "Joins before widening, by loop nesting depth (outermost first)")
+        ->type_name("N");
+    bool no_narrowing = false;
+    app.add_flag("--no-narrowing", no_narrowing, "Do not refine loop invariants by narrowing");
+    app.add_option("--narrowing-iterations", fixpoint.narrowing_iterations, "Maximum narrowing iterations per loop")
+        ->type_name("N");
+    app.add_option("--small-loop-size", fixpoint.small_loop_size, "Unroll loops of at most N basic blocks")
+        ->type_name("N");
+    app.add_option("--unroll-small-loops", fixpoint.small_loop_unrolling, "Extra joins before widening small loops")
+        ->type_name("N");
+
     std::string asmfile;
     app.add_option("--asm", asmfile, "Print disassembly to FILE")->type_name("FILE");
     std::string dotfile;
     app.add_option("--dot", dotfile, "Export control-flow graph to dot FILE")->type_name("FILE");
+#ifdef TRACE_DOMAIN
+    std::string tracefile;
+    app.add_option("--domain-trace", tracefile, "Record numerical domain operations to FILE")->type_name("FILE");
+#endif
 
     app.footer("You can use @headers as the path to instead just show the output field headers.\n");
 
     CLI11_PARSE(app, argc, argv);
     if (verbose)
         ebpf_verifier_options.print_invariants = ebpf_verifier_options.print_failures = true;
+    if (no_narrowing)
+        fixpoint.narrowing = false;
 
     // Main program
 
@@ -138,9 +160,22 @@ int main(int argc, char** argv) {
     }
 
     if (domain == "zoneCrab") {
+#ifdef TRACE_DOMAIN
+        if (!tracefile.empty()) {
+            try {
+                crab::domains::trace_writer_t::open(tracefile);
+            } catch (std::runtime_error& e) {
+                std::cerr << "error: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+#endif
         const auto [res, seconds] = timed_execution([&] {
             return ebpf_verify_program(std::cout, prog, raw_prog.info, &ebpf_verifier_options);
         });
+#ifdef TRACE_DOMAIN
+        crab::domains::trace_writer_t::close();
+#endif
         std::cout << res << "," << seconds << "," << resident_set_size_kb() << "\n";
         return !res;
     } else if (domain == "linux") {
@@ -0,0 +1,398 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+
+// Search for programs that are expensive to verify. Sample programs are
+// mutated at random, and a mutant is kept for further mutation whenever it
+// costs more than its parent by any measure: block transfers during the
+// fixpoint, edges of the largest DBM produced by a join, or time. The most
+// expensive mutants are written as ELF files, to be benchmarked with
+// scripts/runperf.sh like the samples they came from.
+//
+// Each mutant is verified in a child process with a time budget, so that a
+// mutant which takes too long, or makes the verifier exit or crash, is
+// reported as a finding instead of stopping the search.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "CLI11.hpp"
+
+#include "crab_utils/stats.hpp"
+#include "ebpf_verifier.hpp"
+#include "utils.hpp"
+
+using std::string;
+using std::vector;
+
+struct cost_t {
+    unsigned transforms{};
+    unsigned join_edges{};
+    double seconds{};
+};
+
+/// How the verification of a program ended.
+enum class outcome_t {
+    measured, ///< The verifier returned a result, whether the program passed or not.
+    rejected, ///< The program was rejected by unmarshal(), or with an exception by the verifier.
+    timeout,  ///< The verifier was still running when the time budget ran out.
+    error,    ///< The verifier exited, as it does on CRAB_ERROR.
+    crash,    ///< The verifier was killed by a signal.
+};
+
+static const char* name_of(outcome_t outcome) {
+    switch (outcome) {
+    case outcome_t::measured: return "measured";
+    case outcome_t::rejected: return "rejected";
+    case outcome_t::timeout: return "timeout";
+    case outcome_t::error: return "error";
+    case outcome_t::crash: return "crash";
+    }
+    return "";
+}
+
+struct measurement_t {
+    outcome_t outcome{};
+    cost_t cost{};
+};
+
+struct candidate_t {
+    raw_program raw_prog;
+    cost_t cost{};
+    int generation{}; ///< Number of mutations since the sample.
+    outcome_t outcome{outcome_t::measured};
+};
+
+/// Time is noisy, so a mutant only counts as slower than its parent by a margin.
+static constexpr double time_margin = 1.5;
+
+static bool costs_more(const cost_t& c, const cost_t& parent) {
+    return c.transforms > parent.transforms || c.join_edges > parent.join_edges ||
+           c.seconds > parent.seconds * time_margin;
+}
+
+/// The program is rejected if unmarshal() rejects it, or if the verifier
+/// throws an exception, as happens for some malformed control flow and for
+/// instructions the analysis does not support.
+static measurement_t measure_in_process(const raw_program& raw_prog, const ebpf_verifier_options_t& options) {
+    std::variant<InstructionSeq, string> prog_or_error = unmarshal(raw_prog, raw_prog.info.platform);
+    if (std::holds_alternative<string>(prog_or_error)) {
+        return {outcome_t::rejected};
+    }
+    const auto& prog = std::get<InstructionSeq>(prog_or_error);
+
+    crab::CrabStats::reset();
+    std::ostringstream reports;
+    double seconds;
+    try {
+        seconds = std::get<1>(
+            timed_execution([&] { return ebpf_verify_program(reports, prog, raw_prog.info, &options); }));
+    } catch (std::exception&) {
+        return {outcome_t::rejected};
+    }
+    return {outcome_t::measured,
+            cost_t{
+                .transforms = crab::CrabStats::get("fixpoint.count.transform"),
+                .join_edges = crab::CrabStats::get("SplitDBM.max.join_edges"),
+                .seconds = seconds,
+            }};
+}
+
+/// Verify the program in a child process that is killed after timeout
+/// seconds, so that neither a slow program nor one on which the verifier
+/// exits stops the search. A timeout of 0 verifies in this process, without
+/// a budget, as is always done on Windows.
+static measurement_t measure(const raw_program& raw_prog, const ebpf_verifier_options_t& options, unsigned timeout) {
+#ifdef _WIN32
+    return measure_in_process(raw_prog, options);
+#else
+    if (timeout == 0) {
+        return measure_in_process(raw_prog, options);
+    }
+    auto fail = [](const char* what) {
+        std::cerr << "error: " << what << ": " << std::strerror(errno) << std::endl;
+        std::exit(1);
+    };
+    int fds[2];
+    if (pipe(fds) != 0) {
+        fail("pipe");
+    }
+    // Otherwise a child that exits through std::exit() flushes our output again.
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        fail("fork");
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        alarm(timeout);
+        const measurement_t m = measure_in_process(raw_prog, options);
+        const bool written = write(fds[1], &m, sizeof(m)) == sizeof(m);
+        _exit(written ? 0 : 1);
+    }
+    close(fds[1]);
+    measurement_t m;
+    // The read ends early if the child dies before writing.
+    const bool received = read(fds[0], &m, sizeof(m)) == sizeof(m);
+    close(fds[0]);
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            fail("waitpid");
+        }
+    }
+    if (received && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return m;
+    }
+    if (WIFSIGNALED(status)) {
+        if (WTERMSIG(status) == SIGALRM) {
+            return {outcome_t::timeout, cost_t{.seconds = (double)timeout}};
+        }
+        return {outcome_t::crash};
+    }
+    return {outcome_t::error};
+#endif
+}
+
+static bool is_jump(const ebpf_inst& inst) {
+    return (inst.opcode & INST_CLS_MASK) == INST_CLS_JMP && inst.opcode != INST_OP_CALL && inst.opcode != INST_OP_EXIT;
+}
+
+// Mutations change single instructions in place, so that jump offsets and
+// map relocations stay valid. Map loads, which take two slots, are left alone.
+class mutator_t final {
+    std::mt19937_64 rng;
+
+    size_t pick(size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); }
+
+    int32_t interesting_imm(int32_t imm) {
+        static const int32_t constants[]{0,   1,   -1,   2,    4,    8,
+                                         16,  64,  255,  256,  4096, 65535,
+                                         std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min()};
+        // Wrap around like the instruction would, without signed overflow.
+        const auto u = static_cast<uint32_t>(imm);
+        switch (pick(4)) {
+        case 0: return static_cast<int32_t>(u + 1);
+        case 1: return static_cast<int32_t>(u - 1);
+        case 2: return static_cast<int32_t>(0 - u);
+        default: return constants[pick(std::size(constants))];
+        }
+    }
+
+    // Move inst from pc `from` to pc `to`, keeping the target of a jump.
+    static ebpf_inst moved(ebpf_inst inst, size_t from, size_t to) {
+        if (is_jump(inst)) {
+            inst.offset = static_cast<int16_t>(inst.offset + static_cast<int>(from) - static_cast<int>(to));
+        }
+        return inst;
+    }
+
+    void mutate_once(vector<ebpf_inst>& prog, const vector<size_t>& pcs) {
+        const size_t pc = pcs[pick(pcs.size())];
+        ebpf_inst& inst = prog[pc];
+        switch (pick(6)) {
+        case 0: inst.imm = interesting_imm(inst.imm); break;
+        case 1:
+            if (is_jump(inst)) {
+                inst.offset = static_cast<int16_t>(static_cast<int>(pcs[pick(pcs.size())]) - static_cast<int>(pc) - 1);
+            } else {
+                static const int16_t deltas[]{-8, -4, -1, 1, 4, 8};
+                inst.offset += deltas[pick(std::size(deltas))];
+            }
+            break;
+        case 2:
+            if (pick(2)) {
+                inst.dst = pick(11);
+            } else {
+                inst.src = pick(11);
+            }
+            break;
+        case 3:
+            // Replace the operation, keeping the class and the source operand kind.
+            if ((inst.opcode & INST_CLS_MASK) == INST_CLS_ALU || (inst.opcode & INST_CLS_MASK) == INST_CLS_ALU64) {
+                inst.opcode = (inst.opcode & ~INST_ALU_OP_MASK) | (pick(14) << 4);
+            } else if (is_jump(inst)) {
+                static const uint8_t conditions[]{0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0xa0, 0xb0, 0xc0, 0xd0};
+                inst.opcode = (inst.opcode & ~INST_ALU_OP_MASK) | conditions[pick(std::size(conditions))];
+            }
+            break;
+        case 4: {
+            const size_t from = pcs[pick(pcs.size())];
+            inst = moved(prog[from], from, pc);
+            break;
+        }
+        case 5: {
+            const size_t other = pcs[pick(pcs.size())];
+            const ebpf_inst tmp = inst;
+            inst = moved(prog[other], other, pc);
+            prog[other] = moved(tmp, pc, other);
+            break;
+        }
+        }
+    }
+
+  public:
+    explicit mutator_t(uint64_t seed) : rng(seed) {}
+
+    raw_program operator()(raw_program raw_prog) {
+        vector<ebpf_inst>& prog = raw_prog.prog;
+        vector<size_t> pcs;
+        for (size_t pc = 0; pc < prog.size(); pc++) {
+            if (prog[pc].opcode == INST_OP_LDDW_IMM) {
+                pc++;
+            } else {
+                pcs.push_back(pc);
+            }
+        }
+        if (pcs.empty()) {
+            return raw_prog;
+        }
+        for (size_t n = pick(4) + 1; n > 0; n--) {
+            mutate_once(prog, pcs);
+        }
+        return raw_prog;
+    }
+};
+
+static string basename_of(const string& path) {
+    string name = path.substr(path.find_last_of("/\\") + 1);
+    return name.substr(0, name.rfind(".o"));
+}
+
+int main(int argc, char** argv) {
+    ebpf_verifier_options_t ebpf_verifier_options = ebpf_verifier_default_options;
+
+    crab::CrabEnableWarningMsg(false);
+
+    CLI::App app{"Search for eBPF programs that are expensive to verify"};
+
+    vector<string> filenames;
+    app.add_option("path", filenames, "Elf files with the programs to start from")->required()->type_name("FILE");
+    string desired_section;
+    app.add_option("-s,--section", desired_section, "Only start from programs in SECTION")->type_name("SECTION");
+
+    int iterations = 1000;
+    app.add_option("-n,--iterations", iterations, "Number of mutants to verify")->type_name("N");
+    uint64_t seed = 0;
+    app.add_option("--seed", seed, "Seed of the random mutations")->type_name("N");
+    std::string rank = "time";
+    app.add_set("--rank", rank, {"time", "transforms", "join_edges"}, "Cost by which mutants are ranked")
+        ->type_name("COST");
+    size_t keep = 10;
+    app.add_option("-k,--keep", keep, "Number of most expensive mutants, and of mutants that fail to verify, to report")
+        ->type_name("N");
+    string outdir;
+    app.add_option("-o,--out", outdir, "Write the reported mutants as ELF files to the existing DIR")
+        ->type_name("DIR");
+
+    unsigned timeout = 10;
+    app.add_option("-t,--timeout", timeout,
+                   "Report a mutant that takes more than SECONDS to verify, and stop verifying it (0: no limit)")
+        ->type_name("SECONDS");
+
+    app.add_flag("--termination", ebpf_verifier_options.check_termination, "Verify termination");
+
+    CLI11_PARSE(app, argc, argv);
+
+    const ebpf_platform_t* platform = &g_ebpf_platform_linux;
+
+    vector<candidate_t> corpus;
+    for (const string& filename : filenames) {
+        vector<raw_program> raw_progs;
+        try {
+            raw_progs = read_elf(filename, desired_section, &ebpf_verifier_options, platform);
+        } catch (std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << std::endl;
+            return 1;
+        }
+        for (raw_program& raw_prog : raw_progs) {
+            measurement_t m = measure(raw_prog, ebpf_verifier_options, timeout);
+            if (m.outcome == outcome_t::measured) {
+                corpus.push_back(candidate_t{std::move(raw_prog), m.cost, 0});
+            } else if (m.outcome != outcome_t::rejected) {
+                std::cerr << "warning: skipping " << filename << " " << raw_prog.section << ": "
+                          << name_of(m.outcome) << "\n";
+            }
+        }
+    }
+    if (corpus.empty()) {
+        std::cerr << "error: no program to start from\n";
+        return 1;
+    }
+
+    // Mutants that ran out of time, or on which the verifier exited or
+    // crashed. They are reported, but not mutated further.
+    vector<candidate_t> findings;
+
+    mutator_t mutate{seed};
+    std::mt19937_64 rng{seed};
+    for (int i = 0; i < iterations; i++) {
+        const size_t parent = std::uniform_int_distribution<size_t>(0, corpus.size() - 1)(rng);
+        raw_program mutant = mutate(corpus[parent].raw_prog);
+        measurement_t m = measure(mutant, ebpf_verifier_options, timeout);
+        switch (m.outcome) {
+        case outcome_t::measured:
+            if (costs_more(m.cost, corpus[parent].cost)) {
+                corpus.push_back(candidate_t{std::move(mutant), m.cost, corpus[parent].generation + 1});
+            }
+            break;
+        case outcome_t::rejected: break;
+        default:
+            if (findings.size() < keep) {
+                findings.push_back(candidate_t{std::move(mutant), m.cost, corpus[parent].generation + 1, m.outcome});
+            }
+        }
+    }
+
+    auto cost_of = [&](const candidate_t& c) -> double {
+        if (rank == "transforms")
+            return c.cost.transforms;
+        if (rank == "join_edges")
+            return c.cost.join_edges;
+        return c.cost.seconds;
+    };
+    vector<const candidate_t*> mutants;
+    for (const candidate_t& c : corpus) {
+        if (c.generation > 0) {
+            mutants.push_back(&c);
+        }
+    }
+    std::sort(mutants.begin(), mutants.end(),
+              [&](const candidate_t* a, const candidate_t* b) { return cost_of(*a) > cost_of(*b); });
+    mutants.resize(std::min(keep, mutants.size()));
+    for (const candidate_t& c : findings) {
+        mutants.push_back(&c);
+    }
+
+    std::cout << "file,section,generation,outcome,transforms,join_edges,sec\n";
+    for (size_t i = 0; i < mutants.size(); i++) {
+        const candidate_t& c = *mutants[i];
+        string file = c.raw_prog.filename;
+        if (!outdir.empty()) {
+            file = outdir + "/" + basename_of(c.raw_prog.filename) + "-" + std::to_string(i) + ".o";
+            try {
+                write_elf(file, c.raw_prog);
+            } catch (std::runtime_error& e) {
+                std::cerr << "error: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        std::cout << file << "," << c.raw_prog.section << "," << c.generation << "," << name_of(c.outcome) << ","
+                  << c.cost.transforms << ","
+                  << c.cost.join_edges << "," << c.cost.seconds << "\n";
+    }
+    return 0;
+}
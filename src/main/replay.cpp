@@ -0,0 +1,299 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+
+// Re-execute a trace of numerical domain operations recorded by a
+// TRACE_DOMAIN build of check, and report the time spent in each kind of
+// operation. This isolates the cost of the domain from the rest of the
+// analysis, so domain changes can be compared on the exact same workload.
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+#include "CLI11.hpp"
+
+#include "crab/domain_trace.hpp"
+#include "crab/split_dbm.hpp"
+
+using namespace crab;
+using namespace crab::domains;
+
+struct op_stats_t {
+    size_t count{};
+    std::chrono::nanoseconds elapsed{};
+};
+
+// Dom is any numerical domain with the interface of SplitDBM.
+template <typename Dom>
+class replayer_t final {
+    trace_reader_t& trace;
+    std::unordered_map<uint64_t, Dom> values;
+    std::array<op_stats_t, (size_t)trace_op_t::count> stats{};
+    size_t mismatches{};
+
+    // Values are created on first use, so a trace that starts in the middle
+    // of an analysis still replays.
+    Dom& at(uint64_t id) {
+        auto it = values.find(id);
+        if (it == values.end()) {
+            it = values.emplace(id, Dom::top()).first;
+        }
+        return it->second;
+    }
+
+    template <typename F>
+    void timed(trace_op_t op, F f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        op_stats_t& s = stats[(size_t)op];
+        s.elapsed += std::chrono::steady_clock::now() - start;
+        s.count++;
+    }
+
+    // Queries are replayed from states that were reconstructed
+    // operation by operation, so their answers must not change.
+    void expect(bool recorded, bool replayed) {
+        if (recorded != replayed) {
+            mismatches++;
+        }
+    }
+
+    template <typename F>
+    void binary(trace_op_t op, F f) {
+        uint64_t res = trace.get_id();
+        Dom& left = at(trace.get_id());
+        Dom& right = at(trace.get_id());
+        timed(op, [&] {
+            Dom r = f(left, right);
+            at(res) = std::move(r);
+        });
+    }
+
+    void step(trace_op_t op) {
+        switch (op) {
+        case trace_op_t::create_top: {
+            uint64_t id = trace.get_id();
+            timed(op, [&] { at(id) = Dom::top(); });
+            break;
+        }
+        case trace_op_t::create_bottom: {
+            uint64_t id = trace.get_id();
+            timed(op, [&] { at(id) = Dom::bottom(); });
+            break;
+        }
+        case trace_op_t::copy: {
+            uint64_t dst = trace.get_id();
+            Dom& src = at(trace.get_id());
+            timed(op, [&] {
+                Dom copy{src};
+                at(dst) = std::move(copy);
+            });
+            break;
+        }
+        case trace_op_t::drop: {
+            uint64_t id = trace.get_id();
+            timed(op, [&] { values.erase(id); });
+            break;
+        }
+        case trace_op_t::join: {
+            uint64_t res = trace.get_id();
+            uint64_t left = trace.get_id();
+            Dom& right = at(trace.get_id());
+            if (res == left) {
+                Dom& dom = at(left);
+                timed(op, [&] { dom |= right; });
+            } else {
+                Dom& dom = at(left);
+                timed(op, [&] {
+                    Dom r = dom | right;
+                    at(res) = std::move(r);
+                });
+            }
+            break;
+        }
+        case trace_op_t::widen: binary(op, [](Dom& a, Dom& b) { return a.widen(b); }); break;
+        case trace_op_t::widen_thresholds: {
+            uint64_t res = trace.get_id();
+            Dom& left = at(trace.get_id());
+            Dom& right = at(trace.get_id());
+            thresholds_t ts = trace.get_thresholds();
+            timed(op, [&] {
+                Dom r = left.widening_thresholds(right, ts);
+                at(res) = std::move(r);
+            });
+            break;
+        }
+        case trace_op_t::meet: binary(op, [](Dom& a, Dom& b) { return a & b; }); break;
+        case trace_op_t::narrow: binary(op, [](Dom& a, Dom& b) { return a.narrow(b); }); break;
+        case trace_op_t::leq: {
+            Dom& left = at(trace.get_id());
+            Dom& right = at(trace.get_id());
+            bool recorded = trace.get_bool();
+            bool res;
+            timed(op, [&] { res = left <= right; });
+            expect(recorded, res);
+            break;
+        }
+        case trace_op_t::normalize: {
+            Dom& dom = at(trace.get_id());
+            timed(op, [&] { dom.normalize(); });
+            break;
+        }
+        case trace_op_t::forget_var: {
+            Dom& dom = at(trace.get_id());
+            variable_t x = trace.get_var();
+            timed(op, [&] { dom -= x; });
+            break;
+        }
+        case trace_op_t::forget: {
+            Dom& dom = at(trace.get_id());
+            std::vector<variable_t> vars = trace.get_vars();
+            timed(op, [&] { dom.forget(vars); });
+            break;
+        }
+        case trace_op_t::rename: {
+            Dom& dom = at(trace.get_id());
+            std::vector<variable_t> from = trace.get_vars();
+            std::vector<variable_t> to = trace.get_vars();
+            timed(op, [&] { dom.rename(from, to); });
+            break;
+        }
+        case trace_op_t::assign: {
+            Dom& dom = at(trace.get_id());
+            variable_t x = trace.get_var();
+            linear_expression_t e = trace.get_expression();
+            timed(op, [&] { dom.assign(x, e); });
+            break;
+        }
+        case trace_op_t::apply_var: {
+            Dom& dom = at(trace.get_id());
+            binop_t bop = trace.get_binop();
+            variable_t x = trace.get_var();
+            variable_t y = trace.get_var();
+            variable_t z = trace.get_var();
+            timed(op, [&] { dom.apply(bop, x, y, z); });
+            break;
+        }
+        case trace_op_t::apply_const: {
+            Dom& dom = at(trace.get_id());
+            binop_t bop = trace.get_binop();
+            variable_t x = trace.get_var();
+            variable_t y = trace.get_var();
+            number_t k = trace.get_number();
+            timed(op, [&] { dom.apply(bop, x, y, k); });
+            break;
+        }
+        case trace_op_t::add_constraint: {
+            Dom& dom = at(trace.get_id());
+            linear_constraint_t cst = trace.get_constraint();
+            timed(op, [&] { dom += cst; });
+            break;
+        }
+        case trace_op_t::add_constraints: {
+            Dom& dom = at(trace.get_id());
+            std::vector<linear_constraint_t> csts = trace.get_constraints();
+            timed(op, [&] { dom += csts; });
+            break;
+        }
+        case trace_op_t::set: {
+            Dom& dom = at(trace.get_id());
+            variable_t x = trace.get_var();
+            interval_t intv = trace.get_interval();
+            timed(op, [&] { dom.set(x, intv); });
+            break;
+        }
+        case trace_op_t::interval: {
+            Dom& dom = at(trace.get_id());
+            variable_t x = trace.get_var();
+            timed(op, [&] { (void)dom[x]; });
+            break;
+        }
+        case trace_op_t::eval_interval: {
+            Dom& dom = at(trace.get_id());
+            linear_expression_t e = trace.get_expression();
+            timed(op, [&] { (void)dom.eval_interval(e); });
+            break;
+        }
+        case trace_op_t::eval_relational: {
+            Dom& dom = at(trace.get_id());
+            linear_expression_t e = trace.get_expression();
+            timed(op, [&] { (void)dom.eval_relational_interval(e); });
+            break;
+        }
+        case trace_op_t::eval_unit_interval: {
+            Dom& dom = at(trace.get_id());
+            linear_expression_t e = trace.get_expression();
+            timed(op, [&] { (void)dom.eval_unit_interval(e); });
+            break;
+        }
+        case trace_op_t::entail:
+        case trace_op_t::intersect: {
+            Dom& dom = at(trace.get_id());
+            linear_constraint_t cst = trace.get_constraint();
+            bool recorded = trace.get_bool();
+            bool res;
+            timed(op, [&] { res = op == trace_op_t::entail ? dom.entail(cst) : dom.intersect(cst); });
+            expect(recorded, res);
+            break;
+        }
+        case trace_op_t::count: break;
+        }
+    }
+
+  public:
+    explicit replayer_t(trace_reader_t& trace) : trace(trace) {}
+
+    void run() {
+        while (std::optional<trace_op_t> op = trace.next()) {
+            step(*op);
+        }
+    }
+
+    void print(std::ostream& o) const {
+        using ms = std::chrono::duration<double, std::milli>;
+        op_stats_t total;
+        o << "operation,count,total_ms,mean_us\n";
+        for (size_t i = 0; i < stats.size(); i++) {
+            const op_stats_t& s = stats[i];
+            if (s.count == 0) {
+                continue;
+            }
+            o << name_of((trace_op_t)i) << "," << s.count << "," << ms(s.elapsed).count() << ","
+              << ms(s.elapsed).count() * 1000 / s.count << "\n";
+            total.count += s.count;
+            total.elapsed += s.elapsed;
+        }
+        o << "total," << total.count << "," << ms(total.elapsed).count() << ",\n";
+        if (mismatches) {
+            o << mismatches << " query results differ from the recording\n";
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    CLI::App app{"Replay a trace of numerical domain operations"};
+
+    std::string filename;
+    app.add_option("path", filename, "Trace recorded by check --domain-trace")->required()->type_name("FILE");
+
+    CLI11_PARSE(app, argc, argv);
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::cerr << "error: can't open " << filename << "\n";
+        return 1;
+    }
+    try {
+        trace_reader_t trace(in);
+        replayer_t<SplitDBM> replayer(trace);
+        replayer.run();
+        replayer.print(std::cout);
+    } catch (std::runtime_error& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
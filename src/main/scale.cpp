@@ -0,0 +1,72 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+
+// Verify one generated program and print its size, the verification
+// result, time and memory as a line of csv. scripts/scale.sh runs it on
+// growing sizes, one process each, so that memory is measured per size.
+
+#include <iostream>
+#include <sstream>
+
+#include "CLI11.hpp"
+
+#include "asm_generate.hpp"
+#include "asm_ostream.hpp"
+#include "ebpf_verifier.hpp"
+#ifdef _WIN32
+#include "memsize_windows.hpp"
+#else
+#include "memsize_linux.hpp"
+#endif
+#include "utils.hpp"
+
+int main(int argc, char** argv) {
+    ebpf_verifier_options_t ebpf_verifier_options = ebpf_verifier_default_options;
+
+    crab::CrabEnableWarningMsg(false);
+
+    CLI::App app{"Verify a generated eBPF program"};
+
+    std::string family_name;
+    std::set<std::string> families{"@headers"};
+    for (const auto& [name, family] : program_families()) {
+        families.insert(name);
+    }
+    app.add_set("family", family_name, families, "Program family, or @headers for the output field headers")
+        ->required()
+        ->type_name("FAMILY");
+    int n = 1;
+    app.add_option("n", n, "Program size parameter")->type_name("N");
+
+    app.add_flag("--termination", ebpf_verifier_options.check_termination, "Verify termination");
+    app.add_flag("-f", ebpf_verifier_options.print_failures, "Print verifier's failure logs");
+    std::string asmfile;
+    app.add_option("--asm", asmfile, "Print disassembly to FILE")->type_name("FILE");
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (family_name == "@headers") {
+        std::cout << "n,instructions,zoneCrab?,zoneCrab_sec,zoneCrab_kb\n";
+        return 0;
+    }
+
+    InstructionSeq prog;
+    try {
+        prog = generate_program(program_families().at(family_name), n);
+    } catch (std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 64;
+    }
+    if (!asmfile.empty()) {
+        print(prog, asmfile);
+    }
+
+    // Reports go to a string stream, so that the output stays one line of csv.
+    std::ostringstream reports;
+    const auto [res, seconds] = timed_execution([&] {
+        return ebpf_verify_program(ebpf_verifier_options.print_failures ? std::cerr : reports, prog,
+                                   generated_program_info(), &ebpf_verifier_options);
+    });
+    std::cout << n << "," << prog.size() << "," << res << "," << seconds << "," << resident_set_size_kb() << "\n";
+    return !res;
+}
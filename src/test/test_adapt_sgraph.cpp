@@ -0,0 +1,83 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "crab_utils/adapt_sgraph.hpp"
+
+using crab::AdaptGraph;
+using vert_id = AdaptGraph::vert_id;
+using edges_t = std::vector<std::pair<vert_id, long>>;
+
+static edges_t sorted(const AdaptGraph::edge_range_t& range) {
+    edges_t res;
+    for (const auto& e : range) {
+        res.emplace_back(e.vert, (long)e.val);
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+// Vertex 0 and six others, with bounds on every vertex and edges in both
+// directions between several pairs.
+static AdaptGraph some_graph() {
+    AdaptGraph g;
+    g.growTo(7);
+    for (vert_id v = 1; v < 7; v++) {
+        g.add_edge(0, 10 * v, v);
+        g.add_edge(v, -v, 0);
+    }
+    const std::vector<std::pair<vert_id, vert_id>> edges{{1, 2}, {2, 1}, {2, 3}, {3, 4}, {4, 2},
+                                                         {5, 1}, {1, 5}, {3, 6}, {6, 3}, {4, 1}};
+    for (const auto& [s, d] : edges) {
+        g.add_edge(s, 100 * s + d, d);
+    }
+    return g;
+}
+
+static void check_forget(const std::vector<vert_id>& vs) {
+    AdaptGraph batch = some_graph();
+    batch.forget(vs);
+    AdaptGraph sequential = some_graph();
+    for (vert_id v : vs) {
+        sequential.forget(v);
+    }
+
+    REQUIRE(batch.num_edges() == sequential.num_edges());
+    REQUIRE(batch.is_free == sequential.is_free);
+    REQUIRE(batch.free_id == sequential.free_id);
+    for (vert_id v : sequential.verts()) {
+        REQUIRE(sorted(batch.e_succs(v)) == sorted(sequential.e_succs(v)));
+        REQUIRE(sorted(batch.e_preds(v)) == sorted(sequential.e_preds(v)));
+        REQUIRE(batch.lookup(0, v) == sequential.lookup(0, v));
+        REQUIRE(batch.lookup(v, 0) == sequential.lookup(v, 0));
+    }
+    size_t edges = 0;
+    for (vert_id v : batch.verts()) {
+        edges += batch.e_succs(v).size();
+    }
+    REQUIRE(batch.num_edges() == edges);
+
+    // Forgotten vertices are reused, in the same order, without edges.
+    for (size_t i = 0; i < vs.size(); i++) {
+        const vert_id v = batch.new_vertex();
+        REQUIRE(v == sequential.new_vertex());
+        REQUIRE(batch.e_succs(v).size() == 0);
+        REQUIRE(batch.e_preds(v).size() == 0);
+        REQUIRE(!batch.lookup(0, v));
+        REQUIRE(!batch.lookup(v, 0));
+    }
+}
+
+TEST_CASE("Forgetting vertices in one sweep matches forgetting them one by one", "[adapt_sgraph]") {
+    check_forget({3});
+    // 1 and 2 have edges in both directions between them, and both have
+    // edges to and from vertices that are kept.
+    check_forget({2, 1});
+    check_forget({1, 2, 4});
+    check_forget({4, 3, 2, 1});
+    check_forget({1, 2, 3, 4, 5, 6});
+}
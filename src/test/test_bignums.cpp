@@ -0,0 +1,38 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include "catch.hpp"
+
+#include "crab_utils/bignums.hpp"
+
+using namespace crab;
+
+TEST_CASE("z_number arithmetic across the 64-bit boundary", "[bignums]") {
+    const z_number max64 = z_number((signed long long)INT64_MAX);
+    const z_number min64 = z_number((signed long long)INT64_MIN);
+
+    REQUIRE(max64 + 1 == z_number(std::string("9223372036854775808")));
+    REQUIRE(max64 + 1 - 1 == max64);
+    REQUIRE(min64 - 1 == z_number(std::string("-9223372036854775809")));
+    REQUIRE(-min64 == max64 + 1);
+    REQUIRE(min64 / -1 == max64 + 1);
+    REQUIRE(min64 % -1 == 0);
+    REQUIRE(max64 * 2 / 2 == max64);
+    REQUIRE((max64 * max64).fits_slong() == false);
+    REQUIRE((max64 + 1 - 1).fits_slong());
+    REQUIRE(z_number(1) << 64 == z_number(std::string("18446744073709551616")));
+    REQUIRE((z_number(1) << 64) >> 64 == 1);
+    REQUIRE(z_number((unsigned long long)UINT64_MAX) == (z_number(1) << 64) - 1);
+    REQUIRE(max64 + 1 > max64);
+    REQUIRE(min64 - 1 < min64);
+}
+
+TEST_CASE("z_number bitwise operators use two's complement", "[bignums]") {
+    REQUIRE((z_number(-5) >> 1) == -3);
+    REQUIRE((z_number(-5) & 3) == 3);
+    REQUIRE((z_number(-5) | 3) == -5);
+    REQUIRE((z_number(-5) ^ 3) == -8);
+    REQUIRE((z_number(-5) << 2) == -20);
+    REQUIRE((z_number(-5) % 3) == -2);
+    REQUIRE((z_number(-5) / 3) == -1);
+    REQUIRE(z_number(100).fill_ones() == 127);
+}
@@ -0,0 +1,35 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include "catch.hpp"
+
+#include "crab/cfg.hpp"
+#include "platform.hpp"
+
+static size_t count_assertions(const InstructionSeq& prog) {
+    program_info info{.platform = &g_ebpf_platform_linux};
+    cfg_t cfg = prepare_cfg(prog, info, true);
+    size_t res = 0;
+    for (const label_t& label : cfg.labels()) {
+        for (const Instruction& ins : cfg.get_node(label)) {
+            res += std::holds_alternative<Assert>(ins);
+        }
+    }
+    return res;
+}
+
+TEST_CASE("Drop assertions implied by an earlier identical one", "[cfg]") {
+    Packet packet{.width = 4, .offset = 0, .regoffset = {}};
+    Bin mov{.op = Bin::Op::MOV, .dst = Reg{R0_RETURN_VALUE}, .v = Imm{0}, .is64 = true};
+
+    // Both packet accesses need r6 to be the context; the exit needs r0 to be a number.
+    REQUIRE(count_assertions({{label_t(0), packet}, {label_t(1), packet}, {label_t(2), mov}, {label_t(3), Exit{}}}) ==
+            2);
+
+    // Unless r6 is written in between.
+    Bin write_r6{.op = Bin::Op::MOV, .dst = Reg{R6}, .v = Reg{R1_ARG}, .is64 = true};
+    REQUIRE(count_assertions({{label_t(0), packet},
+                              {label_t(1), write_r6},
+                              {label_t(2), packet},
+                              {label_t(3), mov},
+                              {label_t(4), Exit{}}}) == 3);
+}
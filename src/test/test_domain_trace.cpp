@@ -0,0 +1,130 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "catch.hpp"
+
+#include "crab/domain_trace.hpp"
+#include "crab/dsl_syntax.hpp"
+
+using namespace crab;
+using namespace crab::domains;
+using namespace crab::dsl_syntax;
+
+template <typename T>
+static std::string to_string(const T& x) {
+    std::ostringstream s;
+    s << x;
+    return s.str();
+}
+
+// Write a trace with f, and return its bytes.
+template <typename F>
+static std::string write_trace(F f) {
+    const std::string path = (std::filesystem::temp_directory_path() / "test_domain_trace.pvdt").string();
+    trace_writer_t::open(path);
+    f();
+    trace_writer_t::close();
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::filesystem::remove(path);
+    return bytes;
+}
+
+TEST_CASE("Domain trace operations round-trip", "[trace]") {
+    const variable_t x = variable_t::reg(data_kind_t::values, 1);
+    const variable_t y = variable_t::reg(data_kind_t::offsets, 10);
+    const number_t big = number_t(std::string("-1180591620717411303424")); // -2^70
+    const uint64_t long_id = (uint64_t{1} << 63) + 300;
+
+    const interval_t finite{number_t(-5), number_t(std::numeric_limits<int64_t>::max())};
+    const interval_t infinite{bound_t::minus_infinity(), number_t(7)};
+    const interval_t huge{big, bound_t::plus_infinity()};
+    const linear_constraint_t cst = 2 * x - 3 * y < big;
+    const std::vector<linear_constraint_t> csts{x - y <= 0, x == 4, y != -1};
+
+    std::istringstream in(write_trace([&] {
+        trace_writer_t::record(trace_op_t::copy, long_id, uint64_t{127});
+        trace_writer_t::record(trace_op_t::set, uint64_t{1}, x, finite);
+        trace_writer_t::record(trace_op_t::set, uint64_t{1}, y, infinite);
+        trace_writer_t::record(trace_op_t::set, uint64_t{1}, x, huge);
+        trace_writer_t::record(trace_op_t::apply_const, uint64_t{2}, binop_t{bitwise_binop_t::AND}, x, y, big);
+        trace_writer_t::record(trace_op_t::add_constraint, uint64_t{2}, cst);
+        trace_writer_t::record(trace_op_t::add_constraints, uint64_t{2}, csts);
+        trace_writer_t::record(trace_op_t::entail, uint64_t{2}, x - y <= 0, true);
+        trace_writer_t::record(trace_op_t::forget, uint64_t{2}, std::vector<variable_t>{x, y});
+    }));
+    trace_reader_t reader(in);
+
+    REQUIRE(reader.next() == trace_op_t::copy);
+    REQUIRE(reader.get_id() == long_id);
+    REQUIRE(reader.get_id() == 127);
+
+    for (const auto& [v, i] : {std::pair{x, finite}, {y, infinite}, {x, huge}}) {
+        REQUIRE(reader.next() == trace_op_t::set);
+        REQUIRE(reader.get_id() == 1);
+        REQUIRE(reader.get_var().index() == v.index());
+        REQUIRE(reader.get_interval() == i);
+    }
+
+    REQUIRE(reader.next() == trace_op_t::apply_const);
+    REQUIRE(reader.get_id() == 2);
+    REQUIRE(reader.get_binop() == binop_t{bitwise_binop_t::AND});
+    REQUIRE(reader.get_var().index() == x.index());
+    REQUIRE(reader.get_var().index() == y.index());
+    REQUIRE(reader.get_number() == big);
+
+    REQUIRE(reader.next() == trace_op_t::add_constraint);
+    REQUIRE(reader.get_id() == 2);
+    REQUIRE(to_string(reader.get_constraint()) == to_string(cst));
+
+    REQUIRE(reader.next() == trace_op_t::add_constraints);
+    REQUIRE(reader.get_id() == 2);
+    const std::vector<linear_constraint_t> read_csts = reader.get_constraints();
+    REQUIRE(read_csts.size() == csts.size());
+    for (size_t i = 0; i < csts.size(); i++) {
+        REQUIRE(to_string(read_csts[i]) == to_string(csts[i]));
+    }
+
+    REQUIRE(reader.next() == trace_op_t::entail);
+    REQUIRE(reader.get_id() == 2);
+    REQUIRE(to_string(reader.get_constraint()) == to_string(x - y <= 0));
+    REQUIRE(reader.get_bool());
+
+    REQUIRE(reader.next() == trace_op_t::forget);
+    REQUIRE(reader.get_id() == 2);
+    REQUIRE(reader.get_vars() == std::vector<variable_t>{x, y});
+
+    REQUIRE(!reader.next());
+}
+
+TEST_CASE("Domain trace reader checks the header", "[trace]") {
+    const std::string trace = write_trace([] { trace_writer_t::record(trace_op_t::drop, uint64_t{1}); });
+    REQUIRE(trace.substr(0, 4) == "PVDT");
+
+    std::istringstream good(trace);
+    trace_reader_t reader(good);
+    REQUIRE(reader.next() == trace_op_t::drop);
+    REQUIRE(reader.get_id() == 1);
+
+    std::string bad_magic = trace;
+    bad_magic[0] = 'X';
+    std::istringstream in_bad_magic(bad_magic);
+    REQUIRE_THROWS_AS(trace_reader_t(in_bad_magic), std::runtime_error);
+
+    std::string bad_version = trace;
+    bad_version[4]++;
+    std::istringstream in_bad_version(bad_version);
+    REQUIRE_THROWS_AS(trace_reader_t(in_bad_version), std::runtime_error);
+
+    std::istringstream in_short(trace.substr(0, 3));
+    REQUIRE_THROWS_AS(trace_reader_t(in_short), std::runtime_error);
+
+    // The operation is there, but its operand is cut off.
+    std::istringstream in_truncated(trace.substr(0, 6));
+    trace_reader_t truncated(in_truncated);
+    REQUIRE(truncated.next() == trace_op_t::drop);
+    REQUIRE_THROWS_AS(truncated.get_id(), std::runtime_error);
+}
@@ -0,0 +1,17 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include "catch.hpp"
+
+#include "asm_generate.hpp"
+#include "ebpf_verifier.hpp"
+
+TEST_CASE("Generated programs pass verification", "[generate]") {
+    ebpf_verifier_options_t options = ebpf_verifier_default_options;
+    for (const auto& [name, family] : program_families()) {
+        for (int n : {1, 3}) {
+            INFO(name << " " << n);
+            REQUIRE(ebpf_verify_program(std::cout, generate_program(family, n), generated_program_info(), &options));
+        }
+    }
+    REQUIRE_THROWS_AS(generate_program(program_family_t::nested_loops, 10), std::invalid_argument);
+}
@@ -0,0 +1,124 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include "catch.hpp"
+
+#include "crab/ebpf_domain.hpp"
+#include "crab/liveness.hpp"
+
+using namespace crab;
+using namespace crab::domains;
+
+static Instruction mov(uint8_t dst, int imm) {
+    return Bin{.op = Bin::Op::MOV, .dst = Reg{dst}, .v = Imm{(uint64_t)imm}, .is64 = true};
+}
+
+static Instruction mov_reg(uint8_t dst, uint8_t src) {
+    return Bin{.op = Bin::Op::MOV, .dst = Reg{dst}, .v = Reg{src}, .is64 = true};
+}
+
+static Instruction store(int offset, int width, uint8_t src) {
+    return Mem{.access = Deref{.width = width, .basereg = Reg{R10_STACK_POINTER}, .offset = offset},
+               .value = Reg{src},
+               .is_load = false};
+}
+
+static Instruction load(uint8_t dst, int offset, int width) {
+    return Mem{.access = Deref{.width = width, .basereg = Reg{R10_STACK_POINTER}, .offset = offset},
+               .value = Reg{dst},
+               .is_load = true};
+}
+
+static live_vars_t live(std::initializer_list<int> regs, std::initializer_list<std::pair<int, int>> stack) {
+    live_vars_t res;
+    for (int r : regs) {
+        res.regs.set(r);
+    }
+    // Each pair is an offset from r10 and a width.
+    for (const auto& [offset, width] : stack) {
+        for (int i = 0; i < width; i++) {
+            res.stack.set(EBPF_STACK_SIZE + offset + i);
+        }
+    }
+    return res;
+}
+
+// 0: set registers and fill the stack; 1: a loop that reads [r10-8, r10);
+// 2 and 3: the two ways out of the loop, one reading the stack and one
+// reading a register.
+static cfg_t some_cfg() {
+    cfg_t cfg;
+    basic_block_t& entry = cfg.insert(label_t(0));
+    basic_block_t& loop = cfg.insert(label_t(1));
+    basic_block_t& left = cfg.insert(label_t(2));
+    basic_block_t& right = cfg.insert(label_t(3));
+    basic_block_t& exit = cfg.get_node(cfg.exit_label());
+
+    entry.insert(mov(1, 0));
+    entry.insert(mov(2, 5));
+    entry.insert(mov(3, 7));
+    entry.insert(store(-8, 8, 2));
+    entry.insert(store(-12, 2, 2));
+    entry.insert(store(-16, 4, 2));
+    loop.insert(load(0, -8, 8));
+    loop.insert(Bin{.op = Bin::Op::ADD, .dst = Reg{1}, .v = Imm{1}, .is64 = true});
+    left.insert(load(0, -16, 1));
+    left.insert(Exit{});
+    right.insert(mov_reg(0, 2));
+    right.insert(Exit{});
+
+    cfg.get_node(cfg.entry_label()) >> entry;
+    entry >> loop;
+    loop >> loop;
+    loop >> left;
+    loop >> right;
+    left >> exit;
+    right >> exit;
+    return cfg;
+}
+
+TEST_CASE("Liveness of registers and stack bytes through a branch and a loop", "[liveness]") {
+    const liveness_table_t live_out = compute_live_out(some_cfg());
+
+    // Nothing is read after an exit, but r10 is always live.
+    REQUIRE(live_out.at(label_t(2)) == live({R10_STACK_POINTER}, {}));
+    REQUIRE(live_out.at(label_t(3)) == live({R10_STACK_POINTER}, {}));
+
+    // The loop reads r1 and [r10-8, r10) on every iteration, the left exit
+    // reads the byte at r10-16 and the right exit reads r2. r0 is written
+    // by every successor before it is read.
+    const live_vars_t loop = live({1, 2, R10_STACK_POINTER}, {{-16, 1}, {-8, 8}});
+    REQUIRE(live_out.at(label_t(1)) == loop);
+    REQUIRE(live_out.at(label_t(0)) == loop);
+}
+
+TEST_CASE("Forgetting dead stack bytes keeps partially live cells", "[liveness]") {
+    const cfg_t cfg = some_cfg();
+    const liveness_table_t live_out = compute_live_out(cfg);
+
+    ebpf_domain_t dom = ebpf_domain_t::setup_entry(false);
+    for (const Instruction& ins : cfg.get_node(label_t(0))) {
+        std::visit(dom, ins);
+    }
+    const variable_t r2 = reg_pack(2).value;
+    const variable_t r3 = reg_pack(3).value;
+    // Only 8-byte stores keep the value, so look at the types of the cells.
+    const variable_t cell8 = variable_t::cell_var(data_kind_t::types, EBPF_STACK_SIZE - 8, 8);
+    const variable_t cell2 = variable_t::cell_var(data_kind_t::types, EBPF_STACK_SIZE - 12, 2);
+    const variable_t cell4 = variable_t::cell_var(data_kind_t::types, EBPF_STACK_SIZE - 16, 4);
+    const interval_t num{number_t((int)T_NUM)};
+    REQUIRE(dom[r2] == interval_t(number_t(5)));
+    REQUIRE(dom[r3] == interval_t(number_t(7)));
+    for (variable_t v : {cell8, cell2, cell4}) {
+        REQUIRE(dom[v] == num);
+    }
+
+    dom.forget_dead(live_out.at(label_t(0)));
+    REQUIRE(dom[r2] == interval_t(number_t(5)));
+    REQUIRE(dom[cell8] == num);
+    // Only the first byte of [r10-16, r10-12) is live, but the cell is kept.
+    REQUIRE(dom[cell4] == num);
+    // No byte of [r10-12, r10-10) is live.
+    REQUIRE(dom[cell2] == interval_t::top());
+    // r3 is never read.
+    REQUIRE(dom[r3] == interval_t::top());
+}
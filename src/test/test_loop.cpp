@@ -30,3 +30,31 @@ TEST_CASE("Trivial loop: middle", "[sanity][loop]") {
     bool pass = run_ebpf_analysis(std::cout, cfg, info, &options);
     REQUIRE(pass);
 }
+
+TEST_CASE("Loop entered from unreachable code", "[sanity][loop]") {
+    cfg_t cfg;
+
+    basic_block_t& entry = cfg.insert(label_t(0));
+    basic_block_t& middle = cfg.insert(label_t(1));
+    basic_block_t& dead = cfg.insert(label_t(2));
+    basic_block_t& exit = cfg.get_node(cfg.exit_label());
+
+    entry.insert(Bin{.op = Bin::Op::MOV, .dst = Reg{0}, .v = Imm{0}, .is64 = true});
+    middle.insert(Bin{.op = Bin::Op::ADD, .dst = Reg{0}, .v = Imm{1}, .is64 = true});
+    dead.insert(Bin{.op = Bin::Op::MOV, .dst = Reg{0}, .v = Imm{2}, .is64 = true});
+
+    cfg.get_node(cfg.entry_label()) >> entry;
+    entry >> middle;
+    dead >> middle;
+    middle >> middle;
+    middle >> exit;
+
+    ebpf_verifier_options_t options{
+        .check_termination=false
+    };
+    program_info info{
+        .platform = &g_ebpf_platform_linux
+    };
+    bool pass = run_ebpf_analysis(std::cout, cfg, info, &options);
+    REQUIRE(pass);
+}
@@ -0,0 +1,180 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "crab/ebpf_domain.hpp"
+
+using namespace crab;
+using namespace crab::domains;
+
+static Instruction bin(Bin::Op op, uint8_t dst, int64_t imm, bool is64 = true) {
+    return Bin{.op = op, .dst = Reg{dst}, .v = Imm{(uint64_t)imm}, .is64 = is64};
+}
+
+static Instruction bin_reg(Bin::Op op, uint8_t dst, uint8_t src, bool is64 = true) {
+    return Bin{.op = op, .dst = Reg{dst}, .v = Reg{src}, .is64 = is64};
+}
+
+static Instruction assume(Condition::Op op, uint8_t left, int64_t imm) {
+    return Assume{Condition{.op = op, .left = Reg{left}, .right = Imm{(uint64_t)imm}}};
+}
+
+static Instruction assume_reg(Condition::Op op, uint8_t left, uint8_t right) {
+    return Assume{Condition{.op = op, .left = Reg{left}, .right = Reg{right}}};
+}
+
+static Instruction stack_mem(bool is_load, uint8_t reg, int offset, int width) {
+    return Mem{.access = Deref{.width = width, .basereg = Reg{R10_STACK_POINTER}, .offset = offset},
+               .value = Reg{reg},
+               .is_load = is_load};
+}
+
+// r2 is a number in [3, 100], r3 is 10 and r4 points into the stack.
+static const std::vector<Instruction> prefix{
+    Un{.op = Un::Op::LE64, .dst = Reg{2}},
+    assume(Condition::Op::SGE, 2, 3),
+    assume(Condition::Op::SLE, 2, 100),
+    bin(Bin::Op::MOV, 3, 10),
+    bin_reg(Bin::Op::MOV, 4, R10_STACK_POINTER),
+    bin(Bin::Op::ADD, 4, -16),
+};
+
+// Run block from the same state through the lowered micro operations and
+// through the instruction visitor, and check that the states and the
+// assertion checks agree.
+static void check_lowering(const std::vector<Instruction>& block) {
+    basic_block_t bb{label_t(0)};
+    for (const Instruction& ins : block) {
+        bb.insert(ins);
+    }
+    ebpf_domain_t start = ebpf_domain_t::setup_entry(false);
+    for (const Instruction& ins : prefix) {
+        std::visit(start, ins);
+    }
+    REQUIRE(!start.is_bottom());
+
+    auto record = [](std::vector<std::string>& checks) {
+        return [&checks](NumAbsDomain& inv, const linear_constraint_t& cst, const std::string& s) {
+            checks.push_back(s + (inv.entail(cst) ? "" : " (fails)"));
+        };
+    };
+
+    std::vector<std::string> lowered_checks;
+    ebpf_domain_t lowered = start;
+    lowered.set_require_check(record(lowered_checks));
+    lowered(ebpf_domain_t::lower(bb), false);
+
+    std::vector<std::string> direct_checks;
+    ebpf_domain_t direct = start;
+    direct.set_require_check(record(direct_checks));
+    for (const Instruction& ins : block) {
+        std::visit(direct, ins);
+    }
+
+    REQUIRE(lowered.is_bottom() == direct.is_bottom());
+    const bool same = lowered == direct;
+    REQUIRE(same);
+    REQUIRE(lowered_checks == direct_checks);
+}
+
+TEST_CASE("Lowered binary operations on immediates match the instruction visitor", "[lowering]") {
+    check_lowering({
+        bin(Bin::Op::MOV, 5, 7),
+        bin(Bin::Op::ADD, 5, -3),
+        bin(Bin::Op::SUB, 5, 2),
+        bin(Bin::Op::MUL, 5, 6),
+        bin(Bin::Op::DIV, 5, 4),
+        bin(Bin::Op::MOD, 5, 3),
+        bin(Bin::Op::ADD, 2, 5),
+        bin(Bin::Op::OR, 2, 1),
+        bin(Bin::Op::AND, 2, 0xff),
+        bin(Bin::Op::LSH, 2, 2),
+        bin(Bin::Op::RSH, 2, 1),
+        bin(Bin::Op::ARSH, 2, 1),
+        bin(Bin::Op::XOR, 2, 3),
+        bin(Bin::Op::ADD, 3, -20, false),
+        bin(Bin::Op::MOV, 6, -1, false),
+        // Pointer arithmetic.
+        bin(Bin::Op::ADD, 4, 8),
+        bin(Bin::Op::SUB, 4, 4),
+    });
+}
+
+TEST_CASE("Lowered binary operations on registers match the instruction visitor", "[lowering]") {
+    check_lowering({
+        bin_reg(Bin::Op::MOV, 5, 2),
+        bin_reg(Bin::Op::MUL, 5, 3),
+        bin_reg(Bin::Op::DIV, 5, 3),
+        bin_reg(Bin::Op::MOD, 5, 2),
+        bin_reg(Bin::Op::OR, 5, 3),
+        bin_reg(Bin::Op::AND, 5, 2),
+        bin_reg(Bin::Op::LSH, 5, 3),
+        bin_reg(Bin::Op::RSH, 5, 2),
+        bin_reg(Bin::Op::XOR, 5, 3),
+        bin_reg(Bin::Op::MOV, 6, 2, false),
+        bin_reg(Bin::Op::MOV, 7, 4),
+        // ADD and SUB of a register fall back to the instruction visitor.
+        bin_reg(Bin::Op::ADD, 7, 3),
+        bin_reg(Bin::Op::SUB, 7, 2),
+        bin_reg(Bin::Op::SUB, 7, 4),
+    });
+}
+
+TEST_CASE("Lowered unary operations and assumptions match the instruction visitor", "[lowering]") {
+    check_lowering({
+        Un{.op = Un::Op::NEG, .dst = Reg{3}},
+        Un{.op = Un::Op::LE16, .dst = Reg{2}},
+        assume(Condition::Op::LT, 2, 50),
+        assume(Condition::Op::GT, 2, 10),
+        assume(Condition::Op::NE, 2, 20),
+        assume(Condition::Op::SGE, 3, -10),
+        assume(Condition::Op::NSET, 2, 4),
+    });
+    // Comparisons with a register fall back to the instruction visitor.
+    check_lowering({
+        assume_reg(Condition::Op::LE, 3, 2),
+        assume_reg(Condition::Op::GT, 4, R10_STACK_POINTER),
+    });
+    // An assumption that cannot hold.
+    check_lowering({assume(Condition::Op::GT, 2, 100), bin(Bin::Op::MOV, 5, 1)});
+}
+
+TEST_CASE("Lowered stack loads and assertions match the instruction visitor", "[lowering]") {
+    check_lowering({
+        // Stores fall back to the instruction visitor.
+        stack_mem(false, 2, -8, 8),
+        stack_mem(false, 3, -12, 4),
+        stack_mem(false, 4, -24, 8),
+        stack_mem(true, 5, -8, 8),
+        stack_mem(true, 6, -12, 4),
+        stack_mem(true, 7, -24, 8),
+        // Partly written and never written bytes.
+        stack_mem(true, 8, -16, 8),
+        stack_mem(true, 9, -40, 2),
+        // A load through another register falls back.
+        Mem{.access = Deref{.width = 8, .basereg = Reg{4}, .offset = 8}, .value = Reg{0}, .is_load = true},
+    });
+    check_lowering({
+        Assert{TypeConstraint{Reg{2}, TypeGroup::number}},
+        Assert{TypeConstraint{Reg{4}, TypeGroup::stack}},
+        Assert{TypeConstraint{Reg{4}, TypeGroup::number}},
+        Assert{ValidSize{Reg{2}, false}},
+        Assert{Comparable{Reg{2}, Reg{3}}},
+        Assert{Comparable{Reg{2}, Reg{4}}},
+        // These fall back to the instruction visitor.
+        Assert{ValidAccess{Reg{4}, 0, Imm{8}, false}},
+        Assert{ValidAccess{Reg{4}, 16, Imm{8}, false}},
+        Assert{Addable{Reg{4}, Reg{2}}},
+        Assert{ValidStore{Reg{4}, Reg{2}}},
+    });
+}
+
+TEST_CASE("Lowered calls fall back to the instruction visitor", "[lowering]") {
+    Call call;
+    call.func = 5;
+    call.name = "ktime_get_ns";
+    check_lowering({bin(Bin::Op::MOV, 0, 1), call, bin_reg(Bin::Op::MOV, 6, 0), bin(Bin::Op::ADD, 6, 1)});
+}
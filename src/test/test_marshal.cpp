@@ -163,3 +163,48 @@ TEST_CASE("disasm_marshal_Mem", "[disasm][marshal]") {
         }
     }
 }
+
+static const ebpf_inst exit_inst{.opcode = INST_OP_EXIT, .dst = 0, .src = 0, .offset = 0, .imm = 0};
+
+static std::string unmarshal_error(const ebpf_inst& inst) {
+    auto result = unmarshal(raw_program{"", "", {inst, exit_inst}, {}}, &g_ebpf_platform_linux);
+    REQUIRE(std::holds_alternative<std::string>(result));
+    return std::get<std::string>(result);
+}
+
+static ebpf_inst mem_inst(uint8_t cls, uint8_t mode) {
+    return ebpf_inst{.opcode = (uint8_t)(cls | (mode << 5) | INST_SIZE_W), .dst = 0, .src = 0, .offset = 0, .imm = 0};
+}
+
+TEST_CASE("unmarshal rejects unsupported memory modes", "[disasm][marshal]") {
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_LD, INST_LEN)) == "0: LEN\n");
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_LD, INST_MSH)) == "0: MSH\n");
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_LDX, INST_ABS)) == "0: ABS but not LD\n");
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_ST, INST_IND)) == "0: IND but not LD\n");
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_LD, INST_MEM)) == "0: plain LD\n");
+    REQUIRE(unmarshal_error(mem_inst(INST_CLS_LDX, INST_MEM_UNUSED)) == "0: Memory mode 7\n");
+}
+
+TEST_CASE("unmarshal only grows notes up to the last noted instruction", "[disasm][marshal]") {
+    const ebpf_inst mov_r0{.opcode = INST_CLS_ALU64 | 0xb0, .dst = 0, .src = 0, .offset = 0, .imm = 0};
+    const ebpf_inst add_with_offset{.opcode = INST_CLS_ALU64 | INST_SRC_REG, .dst = 0, .src = 1, .offset = 1, .imm = 0};
+
+    std::vector<std::vector<std::string>> notes;
+    REQUIRE(std::holds_alternative<InstructionSeq>(
+        unmarshal(raw_program{"", "", {mov_r0, mov_r0, exit_inst}, {}}, &g_ebpf_platform_linux, notes)));
+    REQUIRE(notes.empty());
+
+    REQUIRE(std::holds_alternative<InstructionSeq>(unmarshal(
+        raw_program{"", "", {mov_r0, add_with_offset, mov_r0, exit_inst}, {}}, &g_ebpf_platform_linux, notes)));
+    REQUIRE(notes.size() == 2);
+    REQUIRE(notes[0].empty());
+    REQUIRE(notes[1] == std::vector<std::string>{"nonzero offset for register alu op"});
+}
+
+TEST_CASE("call argument lists refuse more arguments than they hold", "[disasm][marshal]") {
+    ArgList<ArgPair, 2> pairs;
+    pairs.push_back({ArgPair::Kind::PTR_TO_MEM, Reg{1}, Reg{2}, false});
+    pairs.push_back({ArgPair::Kind::PTR_TO_MEM, Reg{3}, Reg{4}, false});
+    REQUIRE_THROWS_AS(pairs.push_back({ArgPair::Kind::PTR_TO_MEM, Reg{5}, Reg{6}, false}), std::length_error);
+    REQUIRE(pairs.size() == 2);
+}
@@ -0,0 +1,232 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <sstream>
+
+#include "catch.hpp"
+
+#include "crab/dsl_syntax.hpp"
+#include "crab/split_dbm.hpp"
+#include "crab/thresholds.hpp"
+
+using namespace crab;
+using namespace crab::dsl_syntax;
+using crab::domains::SplitDBM;
+
+static const variable_t x = variable_t::reg(data_kind_t::values, 1);
+static const variable_t y = variable_t::reg(data_kind_t::values, 2);
+static const variable_t z = variable_t::reg(data_kind_t::values, 3);
+static const variable_t w = variable_t::reg(data_kind_t::values, 4);
+
+// x = 5, y in [0, 10], z = y + 1.
+static SplitDBM some_state() {
+    SplitDBM dbm = SplitDBM::top();
+    dbm.assign(x, 5);
+    dbm.set(y, interval_t(number_t(0), number_t(10)));
+    dbm.assign(z, y + 1);
+    return dbm;
+}
+
+// Add csts to start in one batch and one by one, and check that both agree.
+static void check_batch(const SplitDBM& start, const std::vector<linear_constraint_t>& csts, bool bottom) {
+    SplitDBM batch = start;
+    batch += csts;
+    SplitDBM sequential = start;
+    for (const linear_constraint_t& cst : csts) {
+        sequential += cst;
+    }
+    REQUIRE(batch.is_bottom() == bottom);
+    REQUIRE(sequential.is_bottom() == bottom);
+    bool batch_leq = batch <= sequential;
+    bool sequential_leq = sequential <= batch;
+    REQUIRE(batch_leq);
+    REQUIRE(sequential_leq);
+    for (variable_t v : {x, y, z, w}) {
+        REQUIRE(batch[v] == sequential[v]);
+        for (variable_t u : {x, y, z, w}) {
+            REQUIRE(batch.eval_relational_interval(v - u) == sequential.eval_relational_interval(v - u));
+        }
+    }
+}
+
+TEST_CASE("Batched difference constraints match one by one assertion", "[split_dbm]") {
+    check_batch(SplitDBM::top(), {x - y <= 3, y - z <= -2, x >= 0, z <= 10, x - w == 0, x - z < 0}, false);
+    check_batch(some_state(), {w - y <= 3, y >= 4, z - w <= 0, w <= 20, y < 8}, false);
+}
+
+TEST_CASE("Batched constraints with non-difference constraints match one by one assertion", "[split_dbm]") {
+    check_batch(SplitDBM::top(), {x - y <= 1, 2 * x + y <= 10, x >= 1, x != 2, y - w <= 0, x + y >= 4, w <= 6},
+                false);
+    check_batch(some_state(), {w - y <= 0, y + w <= 12, z - w <= 2, 3 * w >= 9}, false);
+}
+
+TEST_CASE("Batched constraints that become bottom partway match one by one assertion", "[split_dbm]") {
+    // A difference constraint contradicts an earlier one in the batch.
+    check_batch(SplitDBM::top(), {x <= 3, y - x <= -1, x >= 5, w - y <= 2}, true);
+    // A non-difference constraint contradicts the batch so far.
+    check_batch(SplitDBM::top(), {x >= 0, y >= 0, x + y <= -1, x - y <= 1}, true);
+    // A difference constraint contradicts the starting state.
+    check_batch(some_state(), {w - x <= 0, z - w <= -7, w >= 0}, true);
+}
+
+// x - y <= 2, y - z <= -1, z in [0, 20], w = x + 3.
+static SplitDBM relational_state() {
+    SplitDBM dbm = SplitDBM::top();
+    dbm += x - y <= 2;
+    dbm += y - z <= -1;
+    dbm.set(z, interval_t(number_t(0), number_t(20)));
+    dbm.assign(w, x + 3);
+    return dbm;
+}
+
+static std::string to_string(SplitDBM dbm) {
+    std::ostringstream s;
+    s << dbm;
+    return s.str();
+}
+
+static std::vector<SplitDBM> some_states() {
+    return {SplitDBM::bottom(), SplitDBM::top(), some_state(), relational_state()};
+}
+
+// Answer entail() by copying the DBM, adding the negated constraint and
+// checking for bottom. Equalities are checked as two inequalities.
+static bool entail_by_meet(const SplitDBM& dbm, const linear_constraint_t& cst) {
+    if (cst.is_equality()) {
+        return entail_by_meet(dbm, linear_constraint_t(cst.expression(), cst_kind::INEQUALITY)) &&
+               entail_by_meet(dbm, linear_constraint_t(cst.expression() * number_t(-1), cst_kind::INEQUALITY));
+    }
+    SplitDBM copy = dbm;
+    copy += cst.negate();
+    return copy.is_bottom();
+}
+
+static bool intersect_by_meet(const SplitDBM& dbm, const linear_constraint_t& cst) {
+    SplitDBM copy = dbm;
+    copy += cst;
+    return !copy.is_bottom();
+}
+
+TEST_CASE("entail and intersect match adding the constraint to a copy", "[split_dbm]") {
+    const std::vector<linear_constraint_t> csts{
+        // Constants.
+        linear_constraint_t(linear_expression_t(number_t(0)), cst_kind::INEQUALITY),
+        linear_constraint_t(linear_expression_t(number_t(1)), cst_kind::INEQUALITY),
+        // x + k and -x + k.
+        x <= 5, x >= 5, x == 5, x < 5, x > 4, y <= 10, y < 10, y >= 1, z == 3, w <= 100, w > 100,
+        // x - y + k.
+        z - y == 1, z - y <= 0, z - y < 2, x - y <= 2, x - y < 2, y - x >= -2, w - x == 3, w - z <= 4, w - z <= 5,
+        // Disequations and constraints that are not unit differences.
+        x != 5, x != 6, z - y != 1, x + y <= 15, 2 * y - z <= 9, 2 * x + w >= 0};
+    for (const SplitDBM& start : some_states()) {
+        for (const linear_constraint_t& cst : csts) {
+            SplitDBM dbm = start;
+            INFO(to_string(dbm) << " and " << cst);
+            REQUIRE(dbm.entail(cst) == entail_by_meet(start, cst));
+            REQUIRE(dbm.intersect(cst) == intersect_by_meet(start, cst));
+        }
+    }
+}
+
+// Whether a and b agree on the bounds of every variable and every difference.
+static bool same_bounds(const SplitDBM& a, const SplitDBM& b) {
+    if (a.is_bottom() || b.is_bottom()) {
+        return a.is_bottom() == b.is_bottom();
+    }
+    for (variable_t v : {x, y, z, w}) {
+        if (!(a[v] == b[v])) {
+            return false;
+        }
+        for (variable_t u : {x, y, z, w}) {
+            if (!(a.eval_relational_interval(v - u) == b.eval_relational_interval(v - u))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+TEST_CASE("operator<= matches meeting with the right-hand side", "[split_dbm]") {
+    std::vector<SplitDBM> states = some_states();
+    SplitDBM wider = some_state();
+    wider.set(y, interval_t(number_t(0), number_t(20)));
+    states.push_back(wider);
+    SplitDBM narrower = relational_state();
+    narrower += x - z <= -5;
+    states.push_back(narrower);
+
+    for (const SplitDBM& a : states) {
+        for (const SplitDBM& b : states) {
+            SplitDBM lhs = a;
+            SplitDBM rhs = b;
+            INFO(to_string(lhs) << " <= " << to_string(rhs));
+            SplitDBM meet = lhs & rhs;
+            const bool leq = lhs <= rhs;
+            REQUIRE(leq == same_bounds(meet, a));
+        }
+        // Comparing a state with itself takes the shortcut.
+        SplitDBM self = a;
+        const bool leq = self <= self;
+        REQUIRE(leq);
+    }
+}
+
+// {-oo, -10, 0, 16, 100, +oo}
+static thresholds_t some_thresholds() {
+    thresholds_t ts;
+    for (int n : {16, -10, 100}) {
+        ts.add(bound_t(number_t(n)));
+    }
+    return ts;
+}
+
+TEST_CASE("thresholds find the nearest threshold on either side", "[split_dbm][thresholds]") {
+    const thresholds_t ts = some_thresholds();
+    REQUIRE(ts.size() == 6);
+    const bound_t oo = bound_t::plus_infinity();
+    const bound_t minus_oo = bound_t::minus_infinity();
+    auto n = [](int k) { return bound_t(number_t(k)); };
+
+    REQUIRE(ts.get_next(n(5)) == n(16));
+    REQUIRE(ts.get_next(n(16)) == n(16));
+    REQUIRE(ts.get_next(n(-20)) == n(-10));
+    REQUIRE(ts.get_next(n(101)) == oo);
+    REQUIRE(ts.get_next(minus_oo) == minus_oo);
+    REQUIRE(ts.get_next(oo) == oo);
+
+    REQUIRE(ts.get_prev(n(5)) == n(0));
+    REQUIRE(ts.get_prev(n(-10)) == n(-10));
+    REQUIRE(ts.get_prev(n(-11)) == minus_oo);
+    REQUIRE(ts.get_prev(n(1000)) == n(100));
+    REQUIRE(ts.get_prev(oo) == oo);
+    REQUIRE(ts.get_prev(minus_oo) == minus_oo);
+}
+
+TEST_CASE("widening with thresholds puts back the next threshold past each grown bound", "[split_dbm][thresholds]") {
+    SplitDBM before = SplitDBM::top();
+    before.set(x, interval_t(number_t(0), number_t(5)));
+    before.set(y, interval_t(number_t(-3), number_t(5)));
+    before.set(z, interval_t(number_t(0), number_t(50)));
+    before.set(w, interval_t(number_t(1), number_t(2)));
+    before += x - z <= 0;
+    SplitDBM after = SplitDBM::top();
+    after.set(x, interval_t(number_t(0), number_t(7)));
+    after.set(y, interval_t(number_t(-4), number_t(5)));
+    after.set(z, interval_t(number_t(0), number_t(200)));
+    after.set(w, interval_t(number_t(1), number_t(2)));
+    after += x - z <= 0;
+
+    const unsigned widenings = CrabStats::get("SplitDBM.count.widening");
+    SplitDBM res = before.widening_thresholds(after, some_thresholds());
+    REQUIRE(CrabStats::get("SplitDBM.count.widening") == widenings + 1);
+
+    REQUIRE(res[x] == interval_t(number_t(0), number_t(16)));
+    REQUIRE(res[y] == interval_t(number_t(-10), number_t(5)));
+    // No finite threshold is past 200.
+    REQUIRE(res[z] == interval_t(number_t(0), bound_t::plus_infinity()));
+    // Stable bounds and relations are kept.
+    REQUIRE(res[w] == interval_t(number_t(1), number_t(2)));
+    REQUIRE(res.eval_relational_interval(x - z).ub() == bound_t(number_t(0)));
+
+    const SplitDBM plain = before.widen(after);
+    REQUIRE(plain[x] == interval_t(number_t(0), bound_t::plus_infinity()));
+}
@@ -0,0 +1,58 @@
+// Copyright (c) Prevail Verifier contributors.
+// SPDX-License-Identifier: MIT
+#include <thread>
+
+#include "catch.hpp"
+
+#include "crab/variable.hpp"
+
+using namespace crab;
+
+TEST_CASE("Interned stack cells are keyed by kind, offset and size", "[variable]") {
+    cell_registry_t cells;
+
+    const variable_t c = variable_t::cell_var(data_kind_t::values, 100, 3);
+    REQUIRE(variable_t::cell_var(data_kind_t::values, 100, 3) == c);
+    REQUIRE(variable_t::cell_var(data_kind_t::types, 100, 3) != c);
+    REQUIRE(variable_t::cell_var(data_kind_t::values, 100, 5) != c);
+    // Offsets that agree in their low bits are still different cells.
+    REQUIRE(variable_t::cell_var(data_kind_t::values, 100 + (index_t{1} << 30), 3) != c);
+    REQUIRE(variable_t::cell_var(data_kind_t::values, 100 + (index_t{1} << 40), 3) != c);
+    // Negative offsets, as stored by the array domain.
+    const variable_t neg = variable_t::cell_var(data_kind_t::values, (index_t)-8, 3);
+    REQUIRE(neg != c);
+    REQUIRE(neg != variable_t::cell_var(data_kind_t::values, (index_t)-8 + (index_t{1} << 30), 3));
+
+    REQUIRE(c.cell_of(data_kind_t::values) == std::make_pair(index_t{100}, 3u));
+    REQUIRE(!c.cell_of(data_kind_t::types));
+    REQUIRE(neg.cell_of(data_kind_t::values) == std::make_pair((index_t)-8, 3u));
+    REQUIRE(variable_t::cell_var(data_kind_t::types, 100, 3).is_type());
+}
+
+TEST_CASE("Interned stack cells live as long as their registry", "[variable]") {
+    variable_t first = [] {
+        cell_registry_t cells;
+        return variable_t::cell_var(data_kind_t::values, 100, 3);
+    }();
+    cell_registry_t cells;
+    REQUIRE(!first.cell_of(data_kind_t::values));
+    // A new registry starts from the first interned id again.
+    REQUIRE(variable_t::cell_var(data_kind_t::offsets, 7, 6) == first);
+    REQUIRE(first.cell_of(data_kind_t::offsets) == std::make_pair(index_t{7}, 6u));
+}
+
+TEST_CASE("Each thread interns stack cells in its own registry", "[variable]") {
+    cell_registry_t cells;
+    const variable_t c = variable_t::cell_var(data_kind_t::values, 100, 3);
+
+    std::optional<std::pair<index_t, unsigned>> other_cell;
+    std::thread other([&] {
+        cell_registry_t other_cells;
+        other_cell = variable_t::cell_var(data_kind_t::types, 40, 5).cell_of(data_kind_t::types);
+    });
+    other.join();
+
+    REQUIRE(other_cell == std::make_pair(index_t{40}, 5u));
+    REQUIRE(c.cell_of(data_kind_t::values) == std::make_pair(index_t{100}, 3u));
+    REQUIRE(variable_t::cell_var(data_kind_t::values, 100, 3) == c);
+}